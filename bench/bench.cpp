@@ -0,0 +1,206 @@
+#include "components.h"
+#include "dagraph.h"
+#include "dom_tree.h"
+#include "generator.h"
+#include "stats.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace {
+
+using namespace graphs;
+
+std::string generate_text(GraphShape shape, size_t node_count, bool shuffle_indexes = false) {
+    std::ostringstream text;
+    GraphGenerator({.shape = shape, .node_count = node_count, .seed = node_count,
+                    .shuffle_indexes = shuffle_indexes}).write_text(text);
+
+    return std::move(text).str();
+}
+
+size_t count_edges(const DAGraph& graph) {
+    return graph.successors().edge_count();
+}
+
+// allocated_bytes are counted in the timed part of all iterations, by the benchmark thread only.
+// They are reported with GRAPHS_ENABLE_STATS builds, which count allocations
+void report(benchmark::State& state, GraphShape shape, size_t edge_count, size_t allocated_bytes) {
+    state.SetLabel(std::string(graph_shape_name(shape)));
+    state.counters["edges/s"] = benchmark::Counter(static_cast<double>(edge_count),
+                                                   benchmark::Counter::kIsIterationInvariantRate);
+
+    if (STATS_ENABLED)
+        state.counters["allocated"] = benchmark::Counter(static_cast<double>(allocated_bytes),
+                                                         benchmark::Counter::kAvgIterations,
+                                                         benchmark::Counter::OneK::kIs1024);
+}
+
+// Analyses cache their results, so every iteration gets a fresh graph. The previous graph is
+// destroyed with timing paused too
+template <class Analysis>
+void run_on_fresh_graphs(benchmark::State& state, Analysis analysis, bool shuffle_indexes = false) {
+    const GraphShape shape = static_cast<GraphShape>(state.range(0));
+    const std::string text = generate_text(shape, static_cast<size_t>(state.range(1)), shuffle_indexes);
+
+    std::optional<DAGraph> graph;
+    size_t edge_count = 0;
+    size_t allocated_bytes = 0;
+
+    for (auto _: state) {
+        state.PauseTiming();
+        graph.reset();
+        graph.emplace(text, std::filesystem::path(), false);
+        edge_count = count_edges(*graph);
+        const size_t allocated_before = calling_thread_allocated_bytes();
+        state.ResumeTiming();
+
+        analysis(*graph);
+        allocated_bytes += calling_thread_allocated_bytes() - allocated_before;
+    }
+
+    report(state, shape, edge_count, allocated_bytes);
+}
+
+void BM_Parse(benchmark::State& state) {
+    const GraphShape shape = static_cast<GraphShape>(state.range(0));
+    const std::string text = generate_text(shape, static_cast<size_t>(state.range(1)));
+
+    size_t edge_count = 0;
+    const size_t allocated_before = calling_thread_allocated_bytes();
+
+    for (auto _: state) {
+        DAGraph graph(text, {}, false);
+        edge_count = count_edges(graph);
+        benchmark::DoNotOptimize(graph);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+    report(state, shape, edge_count, calling_thread_allocated_bytes() - allocated_before);
+}
+
+void BM_StronglyConnectedComponents(benchmark::State& state) {
+    run_on_fresh_graphs(state, [](DAGraph& graph) {
+        benchmark::DoNotOptimize(compute_strongly_connected_components(graph.successors()));
+    });
+}
+
+void BM_TopologicalSort(benchmark::State& state) {
+    run_on_fresh_graphs(state, [](DAGraph& graph) {
+        graph.topological_sort();
+    });
+}
+
+void BM_BuildDominatorTree(benchmark::State& state) {
+    run_on_fresh_graphs(state, [](DAGraph& graph) {
+        DomTree dom_tree = graph.build_dominator_tree();
+        benchmark::DoNotOptimize(dom_tree);
+    });
+}
+
+void BM_BuildPostdominatorTree(benchmark::State& state) {
+    run_on_fresh_graphs(state, [](DAGraph& graph) {
+        DomTree postdom_tree = graph.build_postdominator_tree();
+        benchmark::DoNotOptimize(postdom_tree);
+    });
+}
+
+// Shuffled indexes scatter neighbors over node ids, range(2) relabels the graph in reverse
+// postorder before the timed passes
+void BM_RelabeledAnalyses(benchmark::State& state) {
+    const GraphShape shape = static_cast<GraphShape>(state.range(0));
+    const std::string text = generate_text(shape, static_cast<size_t>(state.range(1)), true);
+    const bool relabel = state.range(2);
+
+    std::optional<DAGraph> graph;
+    size_t edge_count = 0;
+    size_t allocated_bytes = 0;
+
+    for (auto _: state) {
+        state.PauseTiming();
+        graph.reset();
+        graph.emplace(text, std::filesystem::path(), false);
+        edge_count = count_edges(*graph);
+
+        if (relabel)
+            graph->relabel_nodes();
+
+        const size_t allocated_before = calling_thread_allocated_bytes();
+        state.ResumeTiming();
+
+        graph->topological_sort();
+        DomTree dom_tree = graph->build_dominator_tree();
+        DomTree postdom_tree = graph->build_postdominator_tree();
+        benchmark::DoNotOptimize(dom_tree);
+        benchmark::DoNotOptimize(postdom_tree);
+
+        allocated_bytes += calling_thread_allocated_bytes() - allocated_before;
+    }
+
+    report(state, shape, edge_count, allocated_bytes);
+}
+
+void BM_RelabelNodes(benchmark::State& state) {
+    run_on_fresh_graphs(state, [](DAGraph& graph) {
+        benchmark::DoNotOptimize(graph.relabel_nodes());
+    }, true);
+}
+
+void BM_Dump(benchmark::State& state) {
+    const std::filesystem::path dump_path = std::filesystem::temp_directory_path() / "graphs_bench_dump";
+
+    run_on_fresh_graphs(state, [&dump_path](DAGraph& graph) {
+        graph.dump(dump_path);
+    });
+
+    std::filesystem::remove(std::filesystem::path(dump_path).replace_extension("dot"));
+}
+
+void graph_sizes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"shape", "nodes"});
+    benchmark->ArgsProduct({
+        {
+            static_cast<int64_t>(GraphShape::CHAIN),
+            static_cast<int64_t>(GraphShape::WIDE_FAN_OUT),
+            static_cast<int64_t>(GraphShape::DIAMOND_LADDER),
+            static_cast<int64_t>(GraphShape::RANDOM_SPARSE),
+            static_cast<int64_t>(GraphShape::CFG_LIKE),
+        },
+        benchmark::CreateRange(1000, 10000000, 10),
+    });
+    benchmark->Unit(benchmark::kMillisecond);
+}
+
+void relabel_sizes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"shape", "nodes", "relabel"});
+    benchmark->ArgsProduct({
+        {
+            static_cast<int64_t>(GraphShape::DIAMOND_LADDER),
+            static_cast<int64_t>(GraphShape::RANDOM_SPARSE),
+            static_cast<int64_t>(GraphShape::CFG_LIKE),
+        },
+        benchmark::CreateRange(10000, 10000000, 10),
+        {0, 1},
+    });
+    benchmark->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Parse)->Apply(graph_sizes);
+BENCHMARK(BM_StronglyConnectedComponents)->Apply(graph_sizes);
+BENCHMARK(BM_TopologicalSort)->Apply(graph_sizes);
+BENCHMARK(BM_BuildDominatorTree)->Apply(graph_sizes);
+BENCHMARK(BM_BuildPostdominatorTree)->Apply(graph_sizes);
+BENCHMARK(BM_RelabeledAnalyses)->Apply(relabel_sizes);
+BENCHMARK(BM_RelabelNodes)->Apply(graph_sizes);
+BENCHMARK(BM_Dump)->Apply(graph_sizes);
+
+BENCHMARK_MAIN();
@@ -7,6 +7,13 @@ CPMFindPackage(
     OPTIONS "BUILD_GMOCK OFF"
 )
 
+CPMFindPackage(
+    NAME benchmark
+    GITHUB_REPOSITORY google/benchmark
+    VERSION 1.9.4
+    OPTIONS "BENCHMARK_ENABLE_TESTING OFF" "BENCHMARK_ENABLE_INSTALL OFF"
+)
+
 CPMAddPackage(
     NAME loguru
     GITHUB_REPOSITORY emilk/loguru
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "node_index.h"
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace graphs {
+
+constexpr NodeId INVALID_NODE = ~NodeId(0);
+
+// Compressed sparse row adjacency lists.
+// Edge insertion moves the node's list to the end of the edge storage, so the storage
+// stops being compact until compact() is called
+class Adjacency {
+public:
+    using Edge = std::pair<NodeId, NodeId>;
+
+    Adjacency() = default;
+
+    // Edges of every node keep their relative order from edges vector
+    Adjacency(size_t node_count, const std::vector<Edge>& edges);
+
+    // Takes ready CSR arrays, offsets must have node_count + 1 elements
+    Adjacency(std::vector<size_t> offsets, std::vector<NodeId> targets)
+        : begins_(std::move(offsets)), ends_(begins_.begin() + 1, begins_.end()),
+          targets_(std::move(targets)) {
+        assert(!begins_.empty() && begins_.back() == targets_.size());
+    }
+
+    std::span<const NodeId> operator[](NodeId node) const {
+        assert(node < node_count());
+
+        return {targets_.data() + begins_[node], targets_.data() + ends_[node]};
+    }
+
+    size_t node_count() const { return ends_.size(); }
+
+    size_t edge_count() const { return targets_.size() - holes_; }
+
+    // Position of node's first edge in the edge storage
+    size_t first_edge(NodeId node) const {
+        assert(node < node_count());
+
+        return begins_[node];
+    }
+
+    // Positions are returned by first_edge() + child number
+    void remove_edges(const std::vector<size_t>& edge_positions);
+
+    void insert_edge(NodeId source, NodeId target);
+
+    // Removes one source -> target edge, returns false if there is none
+    bool erase_edge(NodeId source, NodeId target);
+
+    bool contains_edge(NodeId source, NodeId target) const;
+
+    bool is_compact() const { return compact_; }
+
+    // Restores edge storage order by source node and removes holes
+    void compact();
+
+    Adjacency reversed() const;
+
+    // Valid only for compact storage
+    std::span<const size_t> offsets() const {
+        assert(compact_);
+
+        return begins_;
+    }
+
+    std::span<const NodeId> targets() const {
+        assert(compact_);
+
+        return targets_;
+    }
+
+private:
+    // begins_ has extra element equal to targets_.size()
+    std::vector<size_t> begins_ = {0};
+    std::vector<size_t> ends_;
+    std::vector<NodeId> targets_;
+
+    size_t holes_ = 0;
+    bool compact_ = true;
+};
+
+} // namespace graphs
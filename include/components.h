@@ -0,0 +1,30 @@
+#pragma once
+
+#include "adjacency.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace graphs {
+
+struct StronglyConnectedComponents {
+    // Node -> component number. Components are numbered in reverse topological order:
+    // edges lead inside a component or to a component with a smaller number
+    std::vector<size_t> component;
+
+    size_t count = 0;
+
+    // Members of components with several nodes or a self loop, ascending ids inside a component.
+    // Components are ordered by their first node
+    std::vector<std::vector<NodeId>> cyclic_components;
+};
+
+// Iterative Tarjan algorithm, O(nodes + edges)
+StronglyConnectedComponents compute_strongly_connected_components(const Adjacency& successors);
+
+// Shortest cycle through the first node of every cyclic component, in the order of
+// cyclic_components. Breadth-first search inside each component, O(nodes + edges) in total
+std::vector<std::vector<NodeId>> find_component_cycles(const Adjacency& successors,
+                                                       const StronglyConnectedComponents& components);
+
+} // namespace graphs
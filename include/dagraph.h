@@ -1,39 +1,187 @@
 #pragma once
 
+#include "adjacency.h"
+#include "components.h"
 #include "dom_tree.h"
+#include "dominator_sets.h"
+#include "dominators.h"
 #include "dump.h"
+#include "generator.h"
+#include "graph_traversal.h"
+#include "mapped_file.h"
+#include "topological.h"
 
+#include <cassert>
 #include <cstddef>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <span>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace graphs {
 
+// Const member functions may be called from several threads at once, lazily computed analyses are
+// built by the first caller. Parsing, loop breaking, sorting and edits need exclusive access
 class DAGraph: public DumpableGraph {
 public:
+    static constexpr NodeId START_ID = 0;
+    static constexpr NodeId END_ID   = 1;
+
+    enum class LoopPolicy {
+        REJECT,   //< loops_detected with a cycle per component is thrown
+        CONDENSE, //< strongly connected components become single nodes
+    };
+
+    // parse_threads > 1 parses line-aligned chunks of text concurrently, 0 means all hardware threads.
+    // input_dump is written before loops are checked, its image goes to renderer if it's given
+    DAGraph(std::string_view text,
+            std::filesystem::path input_dump = std::filesystem::path(),
+            bool generate_dot_images = true,
+            size_t parse_threads = 1,
+            LoopPolicy loop_policy = LoopPolicy::REJECT,
+            ImageRenderer* renderer = nullptr);
+
     DAGraph(std::stringstream& text_stream,
             std::filesystem::path input_dump = std::filesystem::path(),
-            bool generate_dot_images = true);
+            bool generate_dot_images = true)
+        : DAGraph(text_stream.view(), input_dump, generate_dot_images) {}
+
+    DAGraph(const MappedFile& file,
+            std::filesystem::path input_dump = std::filesystem::path(),
+            bool generate_dot_images = true,
+            size_t parse_threads = 1,
+            LoopPolicy loop_policy = LoopPolicy::REJECT,
+            ImageRenderer* renderer = nullptr)
+        : DAGraph(file.view(), input_dump, generate_dot_images, parse_threads, loop_policy, renderer) {}
+
+    // Consumes generator lines directly, without text
+    explicit DAGraph(const GraphGenerator& generator, bool generate_dot_images = true,
+                     LoopPolicy loop_policy = LoopPolicy::REJECT);
+
+    // Binary snapshot with node indexes, edges and cached analysis results
+    void save_snapshot(const std::filesystem::path& path) const;
+
+    static bool is_snapshot(const MappedFile& file);
+
+    static DAGraph from_snapshot(const MappedFile& file, bool generate_dot_images = true);
+
+    // Removes DFS back edges, returns their count. Construction already rejects or condenses loops,
+    // so a constructed graph has none
+    [[deprecated("loops are handled by LoopPolicy during construction")]]
+    size_t find_and_break_loops();
+
+    enum class NodeOrder {
+        REVERSE_POSTORDER, //< DFS from Start, children follow their parents
+        BREADTH_FIRST,     //< nodes of one BFS layer from Start are adjacent
+    };
+
+    // Renumbers node ids in the given traversal order and permutes edge storage, so traversals
+    // touch memory mostly sequentially. Start and End keep their ids, node indexes are kept.
+    // Returns old id -> new id. Cached analyses are dropped, the topological order is renumbered
+    std::vector<NodeId> relabel_nodes(NodeOrder order = NodeOrder::REVERSE_POSTORDER);
+
+    // Input indexes of the nodes merged into node by LoopPolicy::CONDENSE, ascending.
+    // Empty for nodes which weren't condensed
+    std::span<const NodeIdx> condensed_indexes(NodeId node) const;
+
+    // Edge edits between regular nodes. Start and End edges follow automatically: nodes without
+    // predecessors hang from Start and nodes without successors lead to End.
+    // Cached dominators and postdominators are updated only for nodes reachable from the edit, or
+    // recomputed if the edit reaches a quarter of the nodes.
+    // Topological order, levels, dominator sets and dominance frontiers are dropped
+    void add_edge(NodeId parent, NodeId child);
+
+    void remove_edge(NodeId parent, NodeId child);
+
+    enum class TopoSortAlgorithm {
+        KAHN,
+        DFS, //< reverse postorder
+    };
+
+    // Renumbers nodes 1..n in topological order. The order is computed on the first call and cached
+    void topological_sort(TopoSortAlgorithm algorithm = TopoSortAlgorithm::KAHN, size_t thread_count = 1);
 
-    size_t find_and_break_loops() {
-        size_t loop_count = start_->count_and_break_loops_traversal(traversal_counter_);
+    // First edge in storage order whose child index isn't greater than its parent index.
+    // Edges are split between thread_count threads
+    std::optional<Adjacency::Edge> find_topological_order_violation(size_t thread_count = 1) const;
 
-        traversal_counter_ += Node::VISITED;
-        return loop_count;
+    bool topological_sort_check(size_t thread_count = 1) const {
+        return !find_topological_order_violation(thread_count).has_value();
     }
 
-    void topological_sort();
+    // Empty until topological_sort() is called
+    const std::vector<NodeId>& topological_order() const { return topological_order_; }
 
-    bool topological_sort_check();
+    // Groups of nodes which only depend on nodes from previous groups. Computed on the first call and cached
+    const TopologicalLevels& topological_levels(size_t thread_count = 1) const;
 
-    DomTree build_dominator_tree();
+    // Computed on the first call and cached
+    const ImmediateDominators& immediate_dominators() const;
 
-    DomTree build_postdominator_tree();
+    const ImmediateDominators& immediate_postdominators() const;
+
+    // Computed on the first call and cached
+    const Adjacency& dominance_frontiers() const;
+
+    const Adjacency& postdominance_frontiers() const;
+
+    // Placement points for definitions in the given nodes (DF+), sorted by node id
+    std::vector<NodeId> iterated_dominance_frontier(std::span<const NodeId> nodes) const {
+        return compute_iterated_dominance_frontier(dominance_frontiers(), nodes);
+    }
+
+    // Full sets over topological levels order. Computed on the first call and cached
+    const DominatorSets& dominator_sets() const;
+
+    const DominatorSets& postdominator_sets() const;
+
+    // Nodes reachable from roots in topological order. Concurrent calls need their own states
+    std::vector<NodeId> reachable_from(std::span<const NodeId> roots, TraversalState& state) const;
+
+    enum class DomAlgorithm {
+        SEMI_NCA,
+        LEVELS,            //< nearest common dominator of predecessors, topological level by level
+        DOMINATOR_BITSETS, //< idoms from dominator_sets()
+        DOMINATOR_SETS,    //< reference path-walking algorithm, exponential on wide graphs
+    };
+
+    // Wide levels of LEVELS algorithm are split between thread_count threads. SEMI_NCA and LEVELS
+    // give the same tree and share cached idoms
+    DomTree build_dominator_tree(DomAlgorithm algorithm = DomAlgorithm::SEMI_NCA,
+                                 size_t thread_count = 1) const;
+
+    DomTree build_postdominator_tree(DomAlgorithm algorithm = DomAlgorithm::SEMI_NCA,
+                                     size_t thread_count = 1) const;
+
+    // Dumps only nodes at most radius edges away from the given ones in either direction.
+    // Nodes with edges leading out of the dump are drawn dashed
+    void dump_neighborhood(std::filesystem::path path, std::span<const NodeId> nodes, size_t radius,
+                           ImageRenderer* renderer = nullptr) const;
+
+    // Dumps linear chains, where each link is the only edge of both its ends, as single boxes
+    void dump_collapsed(std::filesystem::path path, ImageRenderer* renderer = nullptr) const;
+
+    const Adjacency& successors() const { return successors_; }
+
+    const Adjacency& predecessors() const { return predecessors_; }
+
+    size_t node_count() const { return indexes_.size(); }
+
+    NodeIdx get_node_index(NodeId id) const { return indexes_[id]; }
+
+    // INVALID_NODE if there is no node with this index
+    NodeId find_node(NodeIdx index) const;
 
     struct creation_error: public std::runtime_error {
         using std::runtime_error::runtime_error;
@@ -41,53 +189,156 @@ public:
 
     struct loops_detected: public std::runtime_error {
         using std::runtime_error::runtime_error;
+
+        // Message is the number of cyclic components
+        explicit loops_detected(std::vector<std::vector<NodeIdx>> cycle_indexes)
+            : std::runtime_error(std::to_string(cycle_indexes.size())), cycles(std::move(cycle_indexes)) {}
+
+        // Node indexes along the shortest cycle through the first node of every strongly connected
+        // component with loops, empty for rejected edits
+        std::vector<std::vector<NodeIdx>> cycles;
+    };
+
+    struct edit_error: public std::runtime_error {
+        using std::runtime_error::runtime_error;
     };
 
 private:
-    DAGraph(bool generate_dot_images) : DumpableGraph(generate_dot_images) {}
+    struct EmptyGraphTag {};
 
-    virtual void dump_traversal_entry_(std::ofstream& file) override {
-        start_->dump_subtree(file, nullptr, traversal_counter_);
-    }
+    DAGraph(EmptyGraphTag, bool generate_dot_images) : DumpableGraph(generate_dot_images) {}
+
+    using enum TraversalState::Status;
 
-    class Node: public DumpableNode {
+    virtual void dump_traversal_entry_(DotWriter& writer, TraversalState& state) const override;
+
+    // Collects nodes and edges line by line
+    class Builder {
     public:
-        Node(NodeIdx index) : DumpableNode(index) {}
+        // line_indexes[0] is the parent, the rest are its children
+        void add_line(std::span<const NodeIdx> line_indexes);
 
-        void add_child(std::shared_ptr<Node> node) {
-            children_.push_back(node);
-        }
+        void build(DAGraph* graph);
 
-        size_t count_and_break_loops_traversal(size_t traversal_counter);
+    private:
+        struct NodeInfo {
+            NodeId id;
+            bool is_start;
+            bool is_end;
+        };
 
-        void topological_sort_traversal(std::vector<std::weak_ptr<Node>>* stack,
-                                        size_t traversal_counter);
+        // Hash nodes are carved from the arena and released in bulk with the builder
+        std::pmr::monotonic_buffer_resource arena_;
+        std::pmr::unordered_map<NodeIdx, NodeInfo> nodes_{&arena_};
 
-        bool topological_sort_check_traversal(size_t traversal_counter);
+        std::vector<NodeIdx> indexes_ = {DumpableNode::START, DumpableNode::END};
+        std::vector<Adjacency::Edge> edges_;
+    };
 
-        void build_dominator_sets_traversal_(const std::set<NodeIdx>& parent_set);
+    static void parse_text_(std::string_view text, Builder* builder);
 
-        const std::set<NodeIdx>& build_postdominator_sets_traversal_();
+    // Throws or condenses loops, then builds predecessors
+    void resolve_loops_(LoopPolicy loop_policy);
 
-        void build_dominator_tree_traversal_(DomTree* dom_tree, size_t traversal_counter);
+    void condense_(const StronglyConnectedComponents& components);
 
-        void build_postdominator_tree_traversal_(DomTree* postdom_tree, size_t traversal_counter);
+    void index_nodes_();
 
-    private:
-        std::vector<std::shared_ptr<Node>> children_;
+    static void parse_text_parallel_(std::string_view text, Builder* builder, size_t thread_count);
 
-        virtual void dump_subtree_traversal_(std::ofstream& file, size_t traversal_counter) override {
-            for (auto node: children_)
-                node->dump_subtree(file, this, traversal_counter);
-        };
+    // Dense node id -> node index. Start and End have START_ID and END_ID
+    std::vector<NodeIdx> indexes_;
+
+    // Node index -> node id, rebuilt by index_nodes_() whenever indexes_ change
+    std::unordered_map<NodeIdx, NodeId> node_ids_;
+
+    Adjacency successors_;
+    Adjacency predecessors_;
+
+    // Condensed node id -> input indexes of its nodes
+    std::unordered_map<NodeId, std::vector<NodeIdx>> condensed_indexes_;
+
+    std::vector<NodeId> topological_order_;
 
-        std::set<NodeIdx> dominators_;
-        std::set<NodeIdx> postdominators_;
+    // Lazily computed analyses, each is built once under its flag. Edits drop the results
+    // and replace the flags
+    struct CacheFlags {
+        std::once_flag topological_levels;
+        std::once_flag dominators;
+        std::once_flag postdominators;
+        std::once_flag dominator_sets;
+        std::once_flag postdominator_sets;
+        std::once_flag dominance_frontiers;
+        std::once_flag postdominance_frontiers;
     };
 
-    std::shared_ptr<Node> start_ = std::make_shared<Node>(Node::START);
-    std::shared_ptr<Node> end_   = std::make_shared<Node>(Node::END);
+    std::unique_ptr<CacheFlags> cache_flags_ = std::make_unique<CacheFlags>();
+
+    // Marks of non-const passes: edits, sorting, relabeling and loop breaking have exclusive access,
+    // so they share one state and an edit doesn't clear marks of the whole graph
+    TraversalState edit_state_;
+
+    mutable TopologicalLevels topological_levels_;
+
+    mutable ImmediateDominators dominators_;
+    mutable ImmediateDominators postdominators_;
+
+    mutable DominatorSets dominator_sets_;
+    mutable DominatorSets postdominator_sets_;
+
+    mutable Adjacency dominance_frontiers_;
+    mutable Adjacency postdominance_frontiers_;
+
+    void dump_subtree_traversal_(DotWriter& writer, TraversalState& state, NodeId root) const;
+
+    void dump_neighborhood_(DotWriter& writer, TraversalState& state, std::span<const NodeId> nodes,
+                            size_t radius) const;
+
+    void dump_collapsed_(DotWriter& writer) const;
+
+    // Node continues the chain of its only predecessor
+    bool is_chain_link_(NodeId node) const;
+
+    size_t count_and_break_loops_traversal_(TraversalState& state, NodeId root,
+                                            std::vector<size_t>* back_edges) const;
+
+    void topological_sort_traversal_(TraversalState& state, NodeId root,
+                                     std::vector<NodeId>* postorder) const;
+
+    void check_edit_endpoints_(NodeId parent, NodeId child) const;
+
+    // Drops every cached analysis except immediate dominators and postdominators
+    void drop_cached_analyses_();
+
+    // Updates cached analyses after edges between the given sources and targets changed
+    void update_after_edit_(std::span<const NodeId> sources, std::span<const NodeId> targets);
+
+    // Nodes reachable from roots over edges in topological order of that adjacency
+    std::vector<NodeId> reachable_in_topological_order_(TraversalState& state, const Adjacency& edges,
+                                                        std::span<const NodeId> roots) const;
+
+    DomTree build_tree_from_idoms_(DomTree::DomType dom_type, const ImmediateDominators& doms) const;
+
+    // Computed by SEMI_NCA or LEVELS algorithm on the first call
+    const ImmediateDominators& immediate_dominators_(DomAlgorithm algorithm, size_t thread_count) const;
+
+    const ImmediateDominators& immediate_postdominators_(DomAlgorithm algorithm, size_t thread_count) const;
+
+    DomTree build_dominator_tree_sets_() const;
+
+    DomTree build_postdominator_tree_sets_() const;
+
+    void build_dominator_sets_traversal_(TraversalState& state,
+                                         std::pmr::vector<NodeIdxSet>* dominators) const;
+
+    void build_postdominator_sets_traversal_(TraversalState& state,
+                                             std::pmr::vector<NodeIdxSet>* postdominators) const;
+
+    void build_dominator_tree_traversal_(TraversalState& state, DomTree* dom_tree,
+                                         const std::pmr::vector<NodeIdxSet>& dominators) const;
+
+    void build_postdominator_tree_traversal_(TraversalState& state, DomTree* postdom_tree,
+                                             const std::pmr::vector<NodeIdxSet>& postdominators) const;
 };
 
 } //< namespace graphs
-
@@ -1,74 +1,169 @@
 #pragma once
 
+#include "adjacency.h"
 #include "dump.h"
+#include "graph_traversal.h"
 
 #include <cassert>
 #include <cstddef>
+#include <filesystem>
 #include <fstream>
-#include <iostream>
+#include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <set>
-#include <strings.h>
+#include <span>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace graphs {
 
-class DomTreeNode: public DumpableNode {
-public:
-    DomTreeNode(NodeIdx index) : DumpableNode(index) {}
-
-    void add_node_with_dominators_traversal(NodeIdx index,
-                                            const std::set<NodeIdx>& dominators) {
-        for (auto child: children_) {
-            if (dominators.contains(child->index_)) {
-                child->add_node_with_dominators_traversal(index, dominators);
-                return;
-            }
-        }
-
-        assert(index_ != index);
-        children_.push_back(std::make_shared<DomTreeNode>(index));
-    }
-
-    NodeIdx get_index() { return index_; }
-
-private:
-    virtual void dump_subtree_traversal_(std::ofstream& file, size_t traversal_counter) override {
-        for (auto node: children_)
-            node->dump_subtree(file, this, traversal_counter);
-    };
-
-    std::vector<std::shared_ptr<DomTreeNode>> children_;
-};
+// Dominator sets of the reference algorithms, allocated from a pool owned by the caller
+using NodeIdxSet = std::pmr::set<NodeIdx>;
 
+// Tree nodes are kept in parent / first child / next sibling arrays indexed by node position
 class DomTree: public DumpableGraph {
 public:
     enum class DomType : NodeIdx {
         DOMINATOR     = DumpableNode::START,
         POSTDOMINATOR = DumpableNode::END,
     };
-    
-    DomTree(DomType dom_type, bool generate_dot_images = true)
-        : DumpableGraph(generate_dot_images)
-        , root_(std::make_shared<DomTreeNode>(static_cast<NodeIdx>(dom_type))) {}
-
-    void add_node_with_dominators(NodeIdx index,
-                                  const std::set<NodeIdx>& dominators) {
-        if (index == root_->get_index()) {
-            assert(dominators.size() == 1);
-            return;
-        }
-
-        root_->add_node_with_dominators_traversal(index, dominators);
+
+    // Tree with the root only, grows with add_node_* calls
+    DomTree(DomType dom_type, bool generate_dot_images = true);
+
+    // Single pass over immediate dominators of dense nodes, idom[root] == root.
+    // Nodes with INVALID_NODE idom are left out. Node positions are the dense node ids
+    DomTree(DomType dom_type, std::span<const NodeId> idom, std::span<const NodeIdx> indexes,
+            bool generate_dot_images = true);
+
+    // Descends from the root through children which are in dominators
+    void add_node_with_dominators(NodeIdx index, const NodeIdxSet& dominators);
+
+    // Immediate dominator must be already added
+    void add_node_with_idom(NodeIdx index, NodeIdx idom);
+
+    size_t node_count() const { return node_count_; }
+
+    // Node index -> immediate dominator index, root is not included
+    std::map<NodeIdx, NodeIdx> immediate_dominators() const;
+
+    bool operator==(const DomTree& other) const {
+        return indexes_[root_] == other.indexes_[other.root_] &&
+               immediate_dominators() == other.immediate_dominators();
+    }
+
+    // Query numbering is built on the first query and dropped when nodes are added.
+    // Queries may run concurrently, the first one builds the numbering while the others wait
+    bool contains(NodeIdx index) const {
+        prepare_queries_();
+
+        return find_position_(index) != NO_NODE;
+    }
+
+    // Both nodes must be in the tree. In postdominator tree these are postdominance queries
+    bool dominates(NodeIdx dominator, NodeIdx node) const {
+        auto [dominator_pos, node_pos] = query_positions_(dominator, node);
+
+        return preorder_numbers_[dominator_pos] <= preorder_numbers_[node_pos] &&
+               preorder_numbers_[node_pos] <= subtree_ends_[dominator_pos];
     }
 
+    bool strictly_dominates(NodeIdx dominator, NodeIdx node) const {
+        return dominator != node && dominates(dominator, node);
+    }
+
+    bool postdominates(NodeIdx postdominator, NodeIdx node) const {
+        assert(indexes_[root_] == static_cast<NodeIdx>(DomType::POSTDOMINATOR));
+
+        return dominates(postdominator, node);
+    }
+
+    // Lowest node dominating both of them
+    NodeIdx nearest_common_dominator(NodeIdx first, NodeIdx second) const;
+
+    // Dumps the subtree of root down to max_depth levels below it, cut off nodes are drawn dashed
+    void dump_subtree(std::filesystem::path path, NodeIdx root, size_t max_depth,
+                      ImageRenderer* renderer = nullptr) const;
+
 private:
-    virtual void dump_traversal_entry_(std::ofstream& file) override {
-        root_->dump_subtree(file, nullptr, traversal_counter_);
+    static constexpr NodeId NO_NODE = INVALID_NODE;
+
+    virtual void dump_traversal_entry_(DotWriter& writer, TraversalState& state) const override;
+
+    void dump_subtree_traversal_(DotWriter& writer, TraversalState& state, NodeId root,
+                                 size_t max_depth) const;
+
+    NodeId root_ = 0;
+    size_t node_count_ = 0;
+
+    // Position -> node index and links. Positions without parent aren't in the tree, except root
+    std::vector<NodeIdx> indexes_;
+    std::vector<NodeId> parents_;
+    std::vector<NodeId> first_children_;
+    std::vector<NodeId> next_siblings_;
+
+    // Lookup map nodes live in the tree's arena and are released together with it.
+    // unique_ptr keeps the arena address stable when the tree is moved
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_ =
+        std::make_unique<std::pmr::monotonic_buffer_resource>();
+
+    // Node index -> position, filled on demand for trees built from idoms
+    mutable std::pmr::unordered_map<NodeIdx, NodeId> positions_{arena_.get()};
+
+    // Set once the lookup map and query numbering are built. Adding nodes replaces the flag
+    std::unique_ptr<std::once_flag> queries_flag_ = std::make_unique<std::once_flag>();
+    mutable bool queries_ready_ = false;
+
+    mutable std::vector<NodeId> preorder_numbers_;
+    mutable std::vector<NodeId> subtree_ends_; //< last preorder number in the subtree
+
+    // Preorder number -> position
+    mutable std::vector<NodeId> preorder_positions_;
+
+    // lca_table_[level][i] is minimal parent preorder number among preorder numbers i .. i + 2^level - 1
+    mutable std::vector<std::vector<NodeId>> lca_table_;
+
+    bool in_tree_(NodeId pos) const { return pos == root_ || parents_[pos] != NO_NODE; }
+
+    NodeId add_child_(NodeId parent, NodeIdx index);
+
+    NodeId position_(NodeIdx index) {
+        sync_positions_();
+
+        return find_position_(index);
     }
 
-    std::shared_ptr<DomTreeNode> root_;
+    // Lookup without filling the map
+    NodeId find_position_(NodeIdx index) const {
+        auto found = positions_.find(index);
+
+        return found == positions_.end() ? NO_NODE : found->second;
+    }
+
+    void sync_positions_() const;
+
+    void prepare_queries_() const {
+        std::call_once(*queries_flag_, [this]() {
+            sync_positions_();
+            build_query_numbering_();
+            queries_ready_ = true;
+        });
+    }
+
+    void build_query_numbering_() const;
+
+    std::pair<NodeId, NodeId> query_positions_(NodeIdx first, NodeIdx second) const {
+        prepare_queries_();
+
+        NodeId first_pos  = find_position_(first);
+        NodeId second_pos = find_position_(second);
+        assert(first_pos != NO_NODE && second_pos != NO_NODE);
+
+        return {first_pos, second_pos};
+    }
 };
 
 } //< namespace graphs
-
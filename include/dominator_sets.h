@@ -0,0 +1,60 @@
+#pragma once
+
+#include "adjacency.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace graphs {
+
+// Full dominator sets as dense bitsets over topological positions, one pass over the order:
+// every node's set is the intersection of its predecessors' sets plus the node itself.
+// Takes node_count^2 / 8 bytes
+class DominatorSets {
+public:
+    using Word = uint64_t;
+
+    static constexpr size_t WORD_BITS = 64;
+
+    DominatorSets() = default;
+
+    // Order must contain every node and be topological for predecessors.
+    // Nodes without predecessors are roots. Successors with reversed order give postdominator sets
+    DominatorSets(const Adjacency& predecessors, std::span<const NodeId> order);
+
+    size_t node_count() const { return positions_.size(); }
+
+    // Bit i is set if node at topological position i dominates the node
+    std::span<const Word> operator[](NodeId node) const {
+        assert(node < node_count());
+
+        return std::span(bits_).subspan(node * words_per_set_, words_per_set_);
+    }
+
+    size_t position(NodeId node) const { return positions_[node]; }
+
+    NodeId node_at(size_t position) const { return order_[position]; }
+
+    bool dominates(NodeId dominator, NodeId node) const {
+        const size_t pos = positions_[dominator];
+
+        return ((*this)[node][pos / WORD_BITS] >> (pos % WORD_BITS)) & 1;
+    }
+
+    // Idoms are the strict dominators closest to nodes in topological order, roots have themselves
+    std::vector<NodeId> immediate_dominators() const;
+
+private:
+    size_t words_per_set_ = 0;
+
+    std::vector<NodeId> order_;
+    std::vector<size_t> positions_;
+
+    // Row per node id
+    std::vector<Word> bits_;
+};
+
+} // namespace graphs
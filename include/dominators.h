@@ -0,0 +1,69 @@
+#pragma once
+
+#include "adjacency.h"
+#include "topological.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace graphs {
+
+struct ImmediateDominators {
+    // Nodes reachable from root, root first. Every node is preceded by its idom.
+    // Empty after update_immediate_dominators() until compute_dominator_order() is called
+    std::vector<NodeId> order;
+
+    // idom[root] == root, unreachable nodes have INVALID_NODE
+    std::vector<NodeId> idom;
+
+    // Dominator tree depth, root has 0, unreachable nodes have INVALID_NODE
+    std::vector<NodeId> depth;
+
+    // Ancestor jump pointers (Myers): jumps from one depth always land on the same depth, so
+    // nearest common dominator of two nodes takes O(log depth) steps. jump[root] == root
+    std::vector<NodeId> jump;
+};
+
+// Semi-NCA algorithm (Georgiadis, Tarjan) over DFS numbering
+ImmediateDominators compute_immediate_dominators(const Adjacency& successors,
+                                                 const Adjacency& predecessors,
+                                                 NodeId root);
+
+// DAG only: every node's idom is the nearest common dominator of its predecessors, which are all
+// in previous levels. Levels wider than a threshold are split between thread_count threads.
+// reversed_levels walks levels from the last one, for postdominators of the levels' graph.
+// Idoms and depths are the same as of compute_immediate_dominators(), order is sorted by depth.
+// Steps of nearest common dominator searches are added to nca_steps, O(log depth) per predecessor
+ImmediateDominators compute_immediate_dominators_by_levels(const Adjacency& predecessors,
+                                                           const TopologicalLevels& levels,
+                                                           NodeId root,
+                                                           bool reversed_levels,
+                                                           size_t thread_count = 1,
+                                                           size_t* nca_steps = nullptr);
+
+// Fills depth and jump from idom and order
+void compute_dominator_depths(ImmediateDominators* doms);
+
+// Fills order from idom and depth, nodes are sorted by depth
+void compute_dominator_order(ImmediateDominators* doms);
+
+// Recomputes idoms of affected nodes of a DAG after its edges were changed. Affected nodes must
+// include every node reachable from targets of changed edges and come in topological order,
+// so each node's idom is the nearest common dominator of its already known predecessors.
+// Steps of nearest common dominator searches are added to nca_steps
+void update_immediate_dominators(const Adjacency& predecessors,
+                                 std::span<const NodeId> affected,
+                                 ImmediateDominators* doms,
+                                 size_t* nca_steps = nullptr);
+
+// Dominance frontier of every node as adjacency lists (Cooper, Harvey, Kennedy): each join node
+// is added to frontiers of nodes on idom chains from its predecessors up to its idom.
+// Passing successors and postdominators gives postdominance frontiers
+Adjacency compute_dominance_frontiers(const Adjacency& predecessors, const ImmediateDominators& doms);
+
+// Closure of dominance frontiers of the nodes, sorted by node id
+std::vector<NodeId> compute_iterated_dominance_frontier(const Adjacency& frontiers,
+                                                        std::span<const NodeId> nodes);
+
+} // namespace graphs
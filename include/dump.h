@@ -1,38 +1,82 @@
 #pragma once
 
 #include "graph_traversal.h"
+#include "node_index.h"
 
+#include <cstddef>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace graphs {
 
-using NodeIdx = size_t;
+class ImageRenderer;
 
-class DumpableNode: public TraversableNode {
+// Formats dot text into a reusable buffer, which is written out in large blocks
+class DotWriter {
 public:
-    enum StartEndIdx {
-        START =  0ul,
-        END   = ~0ul,
-    };
+    static constexpr size_t FLUSH_SIZE = 16 << 20;
 
-    void set_index(NodeIdx index) { index_ = index; }
+    DotWriter(std::ofstream& file, std::string* buffer) : file_(file), buffer_(*buffer) {
+        buffer_.clear();
+    }
 
-    void dump_subtree(std::ofstream& file, DumpableNode* parent, size_t traversal_counter);
+    // Truncated nodes have edges which are not dumped, they are drawn dashed
+    void node(NodeIdx index, bool truncated = false);
 
-    virtual ~DumpableNode() = default;
-protected:
-    DumpableNode(NodeIdx index) : index_(index) {}
+    // Box standing for a linear chain of length nodes from first to last
+    void chain(NodeIdx first, NodeIdx last, size_t length);
+
+    void edge(NodeIdx parent, NodeIdx child);
+
+    void text(std::string_view text) {
+        buffer_.append(text);
+        flush_if_full_();
+    }
+
+    void flush();
+
+    // Chains count as all of their nodes
+    size_t nodes_written() const { return nodes_written_; }
+
+    size_t edges_written() const { return edges_written_; }
+
+private:
+    std::ofstream& file_;
+    std::string& buffer_;
 
-    virtual void dump_subtree_traversal_(std::ofstream& file, size_t traversal_counter) = 0;
+    size_t nodes_written_ = 0;
+    size_t edges_written_ = 0;
 
-    NodeIdx index_;
+    void append_index_(NodeIdx index);
+
+    void append_label_(NodeIdx index);
+
+    void flush_if_full_() {
+        if (buffer_.size() >= FLUSH_SIZE)
+            flush();
+    }
+};
+
+// Reserved indexes of Start and End nodes
+class DumpableNode {
+public:
+    enum StartEndIdx: NodeIdx {
+        START =  NodeIdx(0),
+        END   = ~NodeIdx(0),
+    };
 };
 
-class DumpableGraph: protected TraversableGraph {
+class DumpableGraph {
 public:
     DumpableGraph(bool generate_dot_images) : generate_dot_images_(generate_dot_images) {}
 
-    void dump(std::filesystem::path path);
+    // Images are rendered by renderer in the background if it is given.
+    // Dumps of one graph may run concurrently, each uses its own traversal state
+    void dump(std::filesystem::path path, ImageRenderer* renderer = nullptr) const;
 
     static void generate_dot_image(std::filesystem::path dot_path);
 
@@ -40,8 +84,11 @@ public:
 protected:
     const bool generate_dot_images_;
 
-    virtual void dump_traversal_entry_(std::ofstream& file) = 0;
+    virtual void dump_traversal_entry_(DotWriter& writer, TraversalState& state) const = 0;
+
+    // Writes the dot header and footer around write_body and renders the image
+    void dump_(std::filesystem::path path, ImageRenderer* renderer,
+               const std::function<void(DotWriter&, TraversalState&)>& write_body) const;
 };
 
 } // namespace graphs
-
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "dump.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string_view>
+
+namespace graphs {
+
+enum class GraphShape {
+    CHAIN,
+    WIDE_FAN_OUT,   //< one node with all others as children
+    DIAMOND_LADDER, //< diamonds joined top to bottom
+    RANDOM_SPARSE,  //< random forward children, density per node on average
+    CFG_LIKE,       //< fallthrough with short forward branches and rare jumps to the exit
+};
+
+std::string_view graph_shape_name(GraphShape shape);
+
+std::optional<GraphShape> parse_graph_shape(std::string_view name);
+
+struct GeneratorOptions {
+    GraphShape shape = GraphShape::RANDOM_SPARSE;
+    size_t node_count = 1000;
+
+    // Average children per node for RANDOM_SPARSE, 1 + branch probability for CFG_LIKE
+    double density = 2.0;
+
+    uint64_t seed = 0;
+
+    // Back edges to nodes a few steps up the path to the carrier node
+    size_t loop_count = 0;
+
+    // Node indexes are a random permutation of 1..node_count instead of topological numbers
+    bool shuffle_indexes = false;
+};
+
+// Streams a graph line by line in O(edges) time and O(nodes) memory
+class GraphGenerator {
+public:
+    // Parent index followed by its children, every parent comes once
+    using LineSink = std::function<void(std::span<const NodeIdx>)>;
+
+    explicit GraphGenerator(const GeneratorOptions& options) : options_(options) {}
+
+    const GeneratorOptions& options() const { return options_; }
+
+    void generate(const LineSink& add_line) const;
+
+    // Text input format, returns the number of edges
+    size_t write_text(std::ostream& stream) const;
+
+private:
+    GeneratorOptions options_;
+};
+
+} // namespace graphs
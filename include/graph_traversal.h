@@ -1,34 +1,73 @@
 #pragma once
 
+#include "node_index.h"
+
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <vector>
 
 namespace graphs {
 
-class TraversableNode {
+// Visit marks and DFS stack of one traversal. Graphs take it from the caller instead of keeping
+// it inside, so const traversals of one graph can run in several threads, each with its own state
+class TraversalState {
 public:
-    enum TraversalStatus {
+    enum Status {
         UNVISITED = 0,
         VISITING  = 1,
         VISITED   = 2,
         INCORRECT = 3,
     };
 
-protected:
-    TraversalStatus traversal_status_(size_t traversal_counter) {
-        assert(traversal_counter_ >= traversal_counter);
-        assert(traversal_counter_ - traversal_counter < INCORRECT);
+    struct Frame {
+        NodeId node;
+        size_t next_child;
+    };
+
+    // Marks of the previous traversal become UNVISITED without clearing them, unless the counter
+    // would wrap around
+    void begin(size_t node_count) {
+        assert(stack_.empty());
+
+        if (counter_ > MAX_COUNTER - 2 * INCORRECT) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            counter_ = 0;
+        }
 
-        return static_cast<TraversalStatus>(traversal_counter_ - traversal_counter);
+        counter_ += INCORRECT;
+        if (marks_.size() < node_count)
+            marks_.resize(node_count, 0);
     }
 
-    size_t traversal_counter_ = UNVISITED;
-};
+    Status status(size_t node) const {
+        assert(node < marks_.size());
+
+        if (marks_[node] < counter_)
+            return UNVISITED;
+
+        assert(marks_[node] - counter_ < INCORRECT);
+        return static_cast<Status>(marks_[node] - counter_);
+    }
 
-class TraversableGraph {
-protected:
-    size_t traversal_counter_ = TraversableNode::UNVISITED;
+    void set_status(size_t node, Status status) {
+        assert(node < marks_.size());
+
+        marks_[node] = static_cast<NodeId>(counter_ + status);
+    }
+
+    // Explicit DFS stack, so deep graphs don't overflow the call stack
+    std::vector<Frame>& stack() { return stack_; }
+
+private:
+    // Marks have the width of node ids, so compact builds halve them
+    static constexpr NodeId MAX_COUNTER = ~NodeId(0);
+
+    // Marks older than counter_ mean UNVISITED
+    NodeId counter_ = 0;
+    std::vector<NodeId> marks_;
+
+    std::vector<Frame> stack_;
 };
 
 } // namespace graphs
-
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace graphs {
+
+// Renders dot files to svg images on background threads, so dumping doesn't wait for dot
+class ImageRenderer {
+public:
+    explicit ImageRenderer(size_t thread_count = 1);
+
+    ImageRenderer(const ImageRenderer&) = delete;
+    ImageRenderer& operator=(const ImageRenderer&) = delete;
+
+    // Renders everything already queued
+    ~ImageRenderer();
+
+    void render(std::filesystem::path dot_path);
+
+    // Blocks until the queue is empty and no image is being rendered
+    void wait();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    std::condition_variable idle_;
+
+    std::deque<std::filesystem::path> queue_;
+    size_t busy_workers_ = 0;
+    bool stopping_ = false;
+
+    // Joined first on destruction
+    std::vector<std::jthread> workers_;
+
+    void work_();
+};
+
+} // namespace graphs
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <barrier>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace graphs {
+
+// Worker threads of a level-by-level pass. They are started once and meet on a barrier before
+// and after every level, so a level costs two barrier phases instead of thread starts and joins
+class LevelThreads {
+public:
+    // thread_count includes the calling thread
+    explicit LevelThreads(size_t thread_count);
+
+    LevelThreads(const LevelThreads&) = delete;
+    LevelThreads& operator=(const LevelThreads&) = delete;
+
+    ~LevelThreads();
+
+    size_t thread_count() const { return workers_.size() + 1; }
+
+    // Calls task(thread) for every thread number concurrently, number 0 on the calling thread.
+    // Returns when all calls are finished
+    void run(const std::function<void(size_t)>& task);
+
+private:
+    std::barrier<> barrier_;
+
+    // Null between levels, workers stop if it is null after the starting phase
+    const std::function<void(size_t)>* task_ = nullptr;
+
+    // Joined first on destruction
+    std::vector<std::jthread> workers_;
+
+    void work_(size_t thread);
+};
+
+} // namespace graphs
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+
+namespace graphs {
+
+// Peak resident set size of the process in bytes, 0 if the platform doesn't report it
+size_t peak_rss_bytes();
+
+} // namespace graphs
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace graphs {
+
+// NodeId is a dense node number used by graph algorithms (0 .. node_count - 1),
+// NodeIdx is a node index from the input.
+// GRAPHS_COMPACT_INDEXES builds make both 32-bit, which halves edges, dominator trees and sets.
+// Node counts and input indexes then have to stay below 2^32 - 1
+#if defined(GRAPHS_COMPACT_INDEXES)
+using NodeId  = uint32_t;
+using NodeIdx = uint32_t;
+#else
+using NodeId  = size_t;
+using NodeIdx = size_t;
+#endif
+
+} // namespace graphs
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace graphs {
+
+// Phases are recorded only when the library is built with GRAPHS_ENABLE_STATS,
+// otherwise PhaseTimer is empty and compiles away
+#if defined(GRAPHS_ENABLE_STATS)
+constexpr bool STATS_ENABLED = true;
+#else
+constexpr bool STATS_ENABLED = false;
+#endif
+
+struct PhaseStats {
+    size_t calls = 0;
+    double wall_seconds = 0;
+
+    size_t nodes_visited = 0;
+    size_t edges_visited = 0;
+
+    // Allocations made by the thread which ran the phase
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+};
+
+// Process-wide, phases may be recorded from several threads
+std::map<std::string, PhaseStats> collected_stats();
+
+void reset_stats();
+
+// Bytes allocated by the calling thread since it started, 0 without GRAPHS_ENABLE_STATS
+size_t calling_thread_allocated_bytes();
+
+// {"enabled": ..., "peak_rss_bytes": ..., "phases": {"<phase>": {...}}}
+void write_stats_json(std::ostream& stream);
+
+#if defined(GRAPHS_ENABLE_STATS)
+
+// Records wall time and allocations from construction to destruction as one phase call.
+// Phases shouldn't be nested, the outer one would include the time of the inner one
+class PhaseTimer {
+public:
+    explicit PhaseTimer(std::string_view phase);
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ~PhaseTimer();
+
+    void add_nodes(size_t count) { stats_.nodes_visited += count; }
+
+    void add_edges(size_t count) { stats_.edges_visited += count; }
+
+    // Innermost phase running in the calling thread, nullptr outside of phases
+    static PhaseTimer* current();
+
+private:
+    std::string_view phase_;
+    std::chrono::steady_clock::time_point start_;
+
+    PhaseTimer* outer_;
+
+    PhaseStats stats_;
+};
+
+// Algorithms count what they visited into the phase of their caller, without knowing its name.
+// Worker threads have no phase, their counts have to be added by the thread which started them
+inline void count_visited(size_t nodes, size_t edges) {
+    if (PhaseTimer* timer = PhaseTimer::current()) {
+        timer->add_nodes(nodes);
+        timer->add_edges(edges);
+    }
+}
+
+#else
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(std::string_view) {}
+
+    void add_nodes(size_t) {}
+
+    void add_edges(size_t) {}
+};
+
+inline void count_visited(size_t, size_t) {}
+
+#endif
+
+} // namespace graphs
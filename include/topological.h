@@ -0,0 +1,38 @@
+#pragma once
+
+#include "adjacency.h"
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace graphs {
+
+// Level-parallel passes process narrower levels in one thread, they are not worth a barrier round
+constexpr size_t PARALLEL_LEVEL_MIN_WIDTH = 4096;
+
+struct TopologicalLevels {
+    // Nodes grouped by level (longest path length from sources), ascending ids inside a level.
+    // Nodes on cycles are not included
+    std::vector<NodeId> order;
+
+    // Level i is order[level_offsets[i] .. level_offsets[i + 1])
+    std::vector<size_t> level_offsets = {0};
+
+    size_t level_count() const { return level_offsets.size() - 1; }
+
+    std::span<const NodeId> level(size_t level_num) const {
+        assert(level_num < level_count());
+
+        return std::span(order).subspan(level_offsets[level_num],
+                                        level_offsets[level_num + 1] - level_offsets[level_num]);
+    }
+};
+
+// Kahn algorithm. Levels wider than a threshold are processed by thread_count threads
+TopologicalLevels compute_topological_levels(const Adjacency& successors,
+                                             const Adjacency& predecessors,
+                                             size_t thread_count = 1);
+
+} // namespace graphs
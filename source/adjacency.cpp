@@ -0,0 +1,125 @@
+#include "adjacency.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+using namespace graphs;
+
+Adjacency::Adjacency(size_t node_count, const std::vector<Edge>& edges)
+    : begins_(node_count + 1, 0), ends_(node_count), targets_(edges.size()) {
+
+    for (auto [source, target]: edges) {
+        assert(source < node_count && target < node_count);
+        begins_[source + 1]++;
+    }
+
+    for (size_t i = 1; i <= node_count; i++)
+        begins_[i] += begins_[i - 1];
+
+    std::copy(begins_.begin(), begins_.end() - 1, ends_.begin());
+
+    for (auto [source, target]: edges)
+        targets_[ends_[source]++] = target;
+}
+
+void Adjacency::remove_edges(const std::vector<size_t>& edge_positions) {
+    if (edge_positions.empty())
+        return;
+
+    for (size_t pos: edge_positions) {
+        assert(pos < targets_.size());
+        targets_[pos] = INVALID_NODE;
+    }
+
+    compact();
+}
+
+void Adjacency::insert_edge(NodeId source, NodeId target) {
+    assert(source < node_count() && target < node_count());
+
+    if (ends_[source] != targets_.size()) {
+        // The list can't grow in place, move it to the end
+        const size_t begin = begins_[source];
+        const size_t end   = ends_[source];
+
+        begins_[source] = targets_.size();
+        for (size_t pos = begin; pos < end; pos++) {
+            targets_.push_back(targets_[pos]);
+            targets_[pos] = INVALID_NODE;
+        }
+        ends_[source] = targets_.size();
+
+        holes_ += end - begin;
+        compact_ = false;
+    }
+
+    targets_.push_back(target);
+    ends_[source]++;
+    begins_.back() = targets_.size();
+
+    if (holes_ > targets_.size() / 2)
+        compact();
+}
+
+bool Adjacency::erase_edge(NodeId source, NodeId target) {
+    assert(source < node_count() && target < node_count());
+
+    auto begin = targets_.begin() + static_cast<ptrdiff_t>(begins_[source]);
+    auto end   = targets_.begin() + static_cast<ptrdiff_t>(ends_[source]);
+
+    auto edge = std::find(begin, end, target);
+    if (edge == end)
+        return false;
+
+    std::move(edge + 1, end, edge);
+    *(end - 1) = INVALID_NODE;
+    ends_[source]--;
+
+    holes_++;
+    compact_ = false;
+
+    return true;
+}
+
+bool Adjacency::contains_edge(NodeId source, NodeId target) const {
+    std::span<const NodeId> children = (*this)[source];
+
+    return std::find(children.begin(), children.end(), target) != children.end();
+}
+
+void Adjacency::compact() {
+    std::vector<NodeId> targets;
+    targets.reserve(edge_count());
+
+    for (NodeId node = 0; node < node_count(); node++) {
+        const size_t begin = targets.size();
+
+        for (size_t pos = begins_[node]; pos < ends_[node]; pos++) {
+            if (targets_[pos] != INVALID_NODE)
+                targets.push_back(targets_[pos]);
+        }
+
+        begins_[node] = begin;
+        ends_[node]   = targets.size();
+    }
+
+    begins_.back() = targets.size();
+    targets_ = std::move(targets);
+
+    holes_ = 0;
+    compact_ = true;
+}
+
+Adjacency Adjacency::reversed() const {
+    std::vector<Edge> edges;
+    edges.reserve(edge_count());
+
+    for (NodeId source = 0; source < node_count(); source++) {
+        for (NodeId target: (*this)[source])
+            edges.emplace_back(target, source);
+    }
+
+    return Adjacency(node_count(), edges);
+}
@@ -0,0 +1,177 @@
+#include "components.h"
+#include "adjacency.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+using namespace graphs;
+
+namespace {
+
+constexpr size_t NOT_NUMBERED = ~size_t(0);
+
+struct Frame {
+    NodeId node;
+    size_t next_child;
+};
+
+} // namespace
+
+StronglyConnectedComponents graphs::compute_strongly_connected_components(const Adjacency& successors) {
+    const size_t node_count = successors.node_count();
+
+    StronglyConnectedComponents result;
+    result.component.assign(node_count, NOT_NUMBERED);
+
+    // DFS preorder numbers and the smallest number reachable through the node's subtree and one
+    // more edge to a node of an unfinished component
+    std::vector<size_t> numbers(node_count, NOT_NUMBERED);
+    std::vector<size_t> lowlinks(node_count);
+
+    // Nodes of unfinished components. A numbered node without component is on it
+    std::vector<NodeId> unfinished;
+    std::vector<Frame> stack;
+
+    size_t next_number = 0;
+    size_t edges_visited = 0;
+
+    auto enter = [&](NodeId node) {
+        numbers[node] = lowlinks[node] = next_number++;
+        unfinished.push_back(node);
+        stack.push_back({node, 0});
+    };
+
+    for (NodeId root = 0; root < node_count; root++) {
+        if (numbers[root] != NOT_NUMBERED)
+            continue;
+
+        enter(root);
+
+        while (!stack.empty()) {
+            auto& [node, next_child] = stack.back();
+            std::span<const NodeId> children = successors[node];
+
+            if (next_child < children.size()) {
+                NodeId child = children[next_child++];
+                edges_visited++;
+
+                if (numbers[child] == NOT_NUMBERED)
+                    enter(child);
+                else if (result.component[child] == NOT_NUMBERED)
+                    lowlinks[node] = std::min(lowlinks[node], numbers[child]);
+
+                continue;
+            }
+
+            const NodeId finished = node;
+            stack.pop_back();
+
+            if (lowlinks[finished] == numbers[finished]) {
+                NodeId member = INVALID_NODE;
+
+                while (member != finished) {
+                    member = unfinished.back();
+                    unfinished.pop_back();
+                    result.component[member] = result.count;
+                }
+
+                result.count++;
+            }
+
+            if (!stack.empty()) {
+                size_t& parent_lowlink = lowlinks[stack.back().node];
+                parent_lowlink = std::min(parent_lowlink, lowlinks[finished]);
+            }
+        }
+    }
+
+    assert(unfinished.empty());
+    count_visited(next_number, edges_visited);
+
+    std::vector<size_t> sizes(result.count, 0);
+    for (NodeId node = 0; node < node_count; node++)
+        sizes[result.component[node]]++;
+
+    std::vector<size_t> cycle_numbers(result.count, NOT_NUMBERED);
+
+    for (NodeId node = 0; node < node_count; node++) {
+        const size_t component = result.component[node];
+        std::span<const NodeId> children = successors[node];
+
+        const bool cyclic = sizes[component] > 1 ||
+                            std::find(children.begin(), children.end(), node) != children.end();
+        if (!cyclic)
+            continue;
+
+        if (cycle_numbers[component] == NOT_NUMBERED) {
+            cycle_numbers[component] = result.cyclic_components.size();
+            result.cyclic_components.emplace_back();
+        }
+
+        result.cyclic_components[cycle_numbers[component]].push_back(node);
+    }
+
+    return result;
+}
+
+std::vector<std::vector<NodeId>> graphs::find_component_cycles(const Adjacency& successors,
+                                                               const StronglyConnectedComponents& components) {
+    std::vector<std::vector<NodeId>> cycles;
+
+    // Search tree parents, reset after every component
+    std::vector<NodeId> parents(successors.node_count(), INVALID_NODE);
+    std::vector<NodeId> queue;
+
+    size_t nodes_visited = 0;
+    size_t edges_visited = 0;
+
+    for (const std::vector<NodeId>& members: components.cyclic_components) {
+        const NodeId first = members.front();
+        const size_t component = components.component[first];
+
+        queue.assign(1, first);
+        parents[first] = first;
+
+        // Node with an edge back to the first one
+        NodeId last = INVALID_NODE;
+
+        for (size_t i = 0; i < queue.size() && last == INVALID_NODE; i++) {
+            const NodeId node = queue[i];
+
+            for (NodeId child: successors[node]) {
+                edges_visited++;
+
+                if (child == first) {
+                    last = node;
+                    break;
+                }
+
+                if (components.component[child] == component && parents[child] == INVALID_NODE) {
+                    parents[child] = node;
+                    queue.push_back(child);
+                }
+            }
+        }
+
+        // Every node of a strongly connected component is on a cycle
+        assert(last != INVALID_NODE);
+
+        std::vector<NodeId>& cycle = cycles.emplace_back();
+        for (NodeId node = last; node != first; node = parents[node])
+            cycle.push_back(node);
+        cycle.push_back(first);
+        std::reverse(cycle.begin(), cycle.end());
+
+        nodes_visited += queue.size();
+        for (NodeId node: queue)
+            parents[node] = INVALID_NODE;
+    }
+
+    count_visited(nodes_visited, edges_visited);
+
+    return cycles;
+}
@@ -1,193 +1,1336 @@
+#include "adjacency.h"
+#include "components.h"
 #include "dagraph.h"
 #include "dom_tree.h"
+#include "dominator_sets.h"
+#include "dominators.h"
 #include "dump.h"
+#include "generator.h"
+#include "mapped_file.h"
+#include "stats.h"
+#include "topological.h"
 #include "graph_traversal.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <charconv>
 #include <cstddef>
 #include <filesystem>
 #include <format>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace graphs;
-using namespace std::literals;
 
-DAGraph::DAGraph(std::stringstream& text_stream, std::filesystem::path input_dump, bool generate_images)
+DAGraph::DAGraph(std::string_view text, std::filesystem::path input_dump, bool generate_images,
+                 size_t parse_threads, LoopPolicy loop_policy, ImageRenderer* renderer)
     : DumpableGraph(generate_images) {
 
-    struct NodeInfo {
-        std::shared_ptr<Node> node;
-        bool is_start;
-        bool is_end;
-    };
+    if (parse_threads == 0)
+        parse_threads = std::max(std::thread::hardware_concurrency(), 1u);
 
-    std::unordered_map<NodeIdx, NodeInfo> nodes;
+    Builder builder;
+    {
+        PhaseTimer timer("parse");
+        if (parse_threads == 1)
+            parse_text_(text, &builder);
+        else
+            parse_text_parallel_(text, &builder, parse_threads);
+    }
+
+    builder.build(this);
+
+    if (!input_dump.empty())
+        dump(input_dump, renderer);
+
+    resolve_loops_(loop_policy);
+}
+
+DAGraph::DAGraph(const GraphGenerator& generator, bool generate_images, LoopPolicy loop_policy)
+    : DumpableGraph(generate_images) {
+
+    Builder builder;
+    {
+        PhaseTimer timer("generate");
+        generator.generate([&builder](std::span<const NodeIdx> line) { builder.add_line(line); });
+    }
+
+    builder.build(this);
+
+    resolve_loops_(loop_policy);
+}
+
+namespace {
+
+// Edits affecting more than 1 / FULL_UPDATE_FRACTION of nodes recompute idoms from scratch,
+// Semi-NCA over the whole graph is cheaper than updating most of it node by node
+constexpr size_t FULL_UPDATE_FRACTION = 4;
+
+bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Appends line indexes. Returns false if line contains anything but blank separated indexes
+bool parse_line_indexes(std::string_view line, std::vector<NodeIdx>* indexes) {
+    assert(indexes);
+
+    const char* pos = line.data();
+    const char* end = line.data() + line.size();
+
+    while (true) {
+        while (pos != end && is_blank(*pos))
+            pos++;
+
+        if (pos == end)
+            return true;
+
+        NodeIdx index = 0;
+        auto [index_end, error] = std::from_chars(pos, end, index);
+
+        if (error != std::errc() || (index_end != end && !is_blank(*index_end)))
+            return false;
+
+        indexes->push_back(index);
+        pos = index_end;
+    }
+}
+
+std::string_view cut_line(std::string_view* text) {
+    assert(text);
+
+    size_t line_end = text->find('\n');
+    std::string_view line = text->substr(0, line_end);
+    text->remove_prefix(line_end == std::string_view::npos ? text->size() : line_end + 1);
+
+    return line;
+}
+
+struct ParsedChunk {
+    std::string_view text;
+
+    // Indexes of all non-empty lines of the chunk one after another
+    std::vector<NodeIdx> indexes;
+    std::vector<size_t> line_ends;
+
+    size_t line_count = 0;
+
+    // Parsing stops at the first malformed line, error_line is 1-based line number in chunk
+    size_t error_line = 0;
+    std::string_view error_text;
+};
+
+void parse_chunk(ParsedChunk* chunk) {
+    assert(chunk);
+
+    for (std::string_view text = chunk->text; !text.empty();) {
+        std::string_view line = cut_line(&text);
+        chunk->line_count++;
+
+        size_t line_begin = chunk->indexes.size();
+
+        if (!parse_line_indexes(line, &chunk->indexes)) {
+            chunk->indexes.resize(line_begin);
+            chunk->error_line = chunk->line_count;
+            chunk->error_text = line;
+            return;
+        }
+
+        if (chunk->indexes.size() != line_begin)
+            chunk->line_ends.push_back(chunk->indexes.size());
+    }
+}
+
+std::vector<ParsedChunk> split_into_chunks(std::string_view text, size_t chunk_count) {
+    assert(chunk_count > 0);
+
+    const size_t chunk_size = text.size() / chunk_count + 1;
+
+    std::vector<ParsedChunk> chunks;
+    chunks.reserve(chunk_count + 1);
+
+    while (!text.empty()) {
+        size_t chunk_end = std::min(chunk_size, text.size());
+
+        size_t line_end = text.find('\n', chunk_end - 1);
+        chunk_end = (line_end == std::string_view::npos) ? text.size() : line_end + 1;
+
+        chunks.emplace_back().text = text.substr(0, chunk_end);
+        text.remove_prefix(chunk_end);
+    }
+
+    return chunks;
+}
+
+} // namespace
+
+void DAGraph::parse_text_(std::string_view text, Builder* builder) {
+    assert(builder);
+
+    std::vector<NodeIdx> line_indexes;
+    size_t line_num = 0;
+
+    while (!text.empty()) {
+        std::string_view line = cut_line(&text);
+        line_num++;
+
+        line_indexes.clear();
+        if (!parse_line_indexes(line, &line_indexes))
+            throw creation_error(std::format("failed to parse line {} \"{}\"", line_num, line));
 
-    for (std::string line; std::getline(text_stream, line);) {
-        if (line.size() == 0)
+        if (line_indexes.empty())
             continue;
 
-        std::istringstream line_stream(line);
+        builder->add_line(line_indexes);
+    }
+}
+
+// Chunks are merged in text order, so errors are the same as in sequential parsing
+void DAGraph::parse_text_parallel_(std::string_view text, Builder* builder, size_t thread_count) {
+    assert(builder);
+    assert(thread_count > 0);
+
+    constexpr size_t CHUNKS_PER_THREAD = 4;
+    std::vector<ParsedChunk> chunks = split_into_chunks(text, thread_count * CHUNKS_PER_THREAD);
 
-        NodeIdx parent_index = 0;
-        line_stream >> parent_index;
-        if (line_stream.fail())
-            throw creation_error("failed to parse line \""s + line + "\""s);
+    std::atomic<size_t> next_chunk = 0;
+    {
+        std::vector<std::jthread> workers;
+        for (size_t i = 0; i < std::min(thread_count, chunks.size()); i++) {
+            workers.emplace_back([&chunks, &next_chunk]() {
+                for (size_t chunk = next_chunk++; chunk < chunks.size(); chunk = next_chunk++)
+                    parse_chunk(&chunks[chunk]);
+            });
+        }
+    }
 
-        auto [node, is_inserted] = nodes.try_emplace(parent_index, std::make_shared<Node>(parent_index), true, true);
-        if (!is_inserted && !node->second.is_end)
-            throw creation_error(std::format("Trying to add existing node {}", parent_index));
+    size_t line_num = 0;
+    for (ParsedChunk& chunk: chunks) {
+        size_t line_begin = 0;
+        for (size_t line_end: chunk.line_ends) {
+            builder->add_line(std::span(chunk.indexes).subspan(line_begin, line_end - line_begin));
+            line_begin = line_end;
+        }
 
-        NodeIdx child_index = 0;
-        while (line_stream >> child_index) {
-            auto [child, is_inserted] = nodes.try_emplace(child_index, std::make_shared<Node>(child_index), false, true);
+        if (chunk.error_line != 0)
+            throw creation_error(std::format("failed to parse line {} \"{}\"",
+                                             line_num + chunk.error_line, chunk.error_text));
 
-            node->second.node->add_child(child->second.node);
+        line_num += chunk.line_count;
+
+        chunk.indexes = {};
+        chunk.line_ends = {};
+    }
+}
+
+void DAGraph::Builder::add_line(std::span<const NodeIdx> line_indexes) {
+    assert(!line_indexes.empty());
+
+    // Every index of the line may be a new node, their ids have to stay below INVALID_NODE
+    if (line_indexes.size() >= INVALID_NODE - indexes_.size())
+        throw creation_error(std::format("More than {} nodes don't fit node ids", INVALID_NODE - 1));
+
+    for (NodeIdx index: line_indexes) {
+        if (index == DumpableNode::START || index == DumpableNode::END)
+            throw creation_error(std::format("Node index {} is reserved for Start and End", index));
+    }
 
-            node->second.is_end = false;
+    NodeIdx parent_index = line_indexes[0];
+
+    auto [node, is_inserted] = nodes_.try_emplace(parent_index, static_cast<NodeId>(indexes_.size()),
+                                                  true, true);
+    if (is_inserted)
+        indexes_.push_back(parent_index);
+    else if (!node->second.is_end)
+        throw creation_error(std::format("Trying to add existing node {}", parent_index));
+
+    for (NodeIdx child_index: line_indexes.subspan(1)) {
+        auto [child, is_inserted] = nodes_.try_emplace(child_index, static_cast<NodeId>(indexes_.size()),
+                                                       false, true);
+        if (is_inserted)
+            indexes_.push_back(child_index);
+
+        child->second.is_start = false;
+        edges_.emplace_back(node->second.id, child->second.id);
+
+        node->second.is_end = false;
+    }
+}
+
+void DAGraph::Builder::build(DAGraph* graph) {
+    assert(graph);
+
+    PhaseTimer timer("build");
+
+    std::vector<bool> is_start(indexes_.size(), false);
+    std::vector<bool> is_end(indexes_.size(), false);
+
+    for (auto node: nodes_) {
+        is_start[node.second.id] = node.second.is_start;
+        is_end[node.second.id]   = node.second.is_end;
+    }
+
+    for (NodeId id = END_ID + 1; id < indexes_.size(); id++) {
+        if (is_start[id])
+            edges_.emplace_back(START_ID, id);
+
+        if (is_end[id])
+            edges_.emplace_back(id, END_ID);
+    }
+
+    if (nodes_.empty())
+        edges_.emplace_back(START_ID, END_ID);
+
+    timer.add_nodes(indexes_.size());
+    timer.add_edges(edges_.size());
+
+    graph->successors_ = Adjacency(indexes_.size(), edges_);
+    graph->indexes_ = std::move(indexes_);
+}
+
+void DAGraph::resolve_loops_(LoopPolicy loop_policy) {
+    StronglyConnectedComponents components;
+    {
+        PhaseTimer timer("strongly_connected_components");
+        components = compute_strongly_connected_components(successors_);
+    }
+
+    if (!components.cyclic_components.empty()) {
+        switch (loop_policy) {
+            case LoopPolicy::REJECT: {
+                std::vector<std::vector<NodeIdx>> cycles;
+
+                for (const std::vector<NodeId>& cycle: find_component_cycles(successors_, components)) {
+                    std::vector<NodeIdx>& cycle_indexes = cycles.emplace_back();
+
+                    for (NodeId node: cycle)
+                        cycle_indexes.push_back(indexes_[node]);
+                }
+
+                throw loops_detected(std::move(cycles));
+            }
+
+            case LoopPolicy::CONDENSE:
+                condense_(components);
+                break;
+
+            default:
+                assert(0 && "Unknown loop policy");
+                break;
         }
-        if (line_stream.fail() && !line_stream.eof())
-            throw creation_error("failed to parse line \""s + line + "\""s);
+    }
+
+    predecessors_ = successors_.reversed();
+    index_nodes_();
+}
+
+// Components keep the relative order of their first nodes, so Start and End keep their ids
+void DAGraph::condense_(const StronglyConnectedComponents& components) {
+    PhaseTimer timer("condense_loops");
+
+    std::vector<NodeId> condensed_ids(components.count, INVALID_NODE);
+    std::vector<NodeId> new_ids(node_count());
+    std::vector<NodeIdx> new_indexes;
 
+    for (NodeId node = 0; node < node_count(); node++) {
+        NodeId& condensed_id = condensed_ids[components.component[node]];
 
+        if (condensed_id == INVALID_NODE) {
+            condensed_id = static_cast<NodeId>(new_indexes.size());
+            new_indexes.push_back(indexes_[node]);
+        }
+
+        new_ids[node] = condensed_id;
     }
 
-    for (auto node: nodes) {
-        if (node.second.is_start)
-            start_->add_child(node.second.node);
+    assert(new_ids[START_ID] == START_ID && new_ids[END_ID] == END_ID);
+
+    for (const std::vector<NodeId>& members: components.cyclic_components) {
+        std::vector<NodeIdx>& member_indexes = condensed_indexes_[new_ids[members.front()]];
+
+        for (NodeId node: members)
+            member_indexes.push_back(indexes_[node]);
 
-        if (node.second.is_end)
-            node.second.node->add_child(end_);
+        std::sort(member_indexes.begin(), member_indexes.end());
+        new_indexes[new_ids[members.front()]] = member_indexes.front();
     }
 
-    if (!input_dump.empty())
-        dump(input_dump);
+    std::vector<Adjacency::Edge> edges;
+    edges.reserve(successors_.edge_count());
+
+    for (NodeId node = 0; node < node_count(); node++) {
+        timer.add_nodes(1);
+        timer.add_edges(successors_[node].size());
 
+        for (NodeId child: successors_[node]) {
+            if (new_ids[node] != new_ids[child])
+                edges.emplace_back(new_ids[node], new_ids[child]);
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // Cycles without entries or exits were not connected to Start or End
+    std::vector<bool> has_parent(new_indexes.size(), false);
+    std::vector<bool> has_child(new_indexes.size(), false);
+
+    for (auto [parent, child]: edges) {
+        has_child[parent] = true;
+        has_parent[child] = true;
+    }
+
+    for (NodeId node = END_ID + 1; node < new_indexes.size(); node++) {
+        if (!has_parent[node])
+            edges.emplace_back(START_ID, node);
+
+        if (!has_child[node])
+            edges.emplace_back(node, END_ID);
+    }
+
+    indexes_    = std::move(new_indexes);
+    successors_ = Adjacency(indexes_.size(), edges);
+}
+
+std::vector<NodeId> DAGraph::relabel_nodes(NodeOrder order) {
+    PhaseTimer timer("relabel_nodes");
+
+    std::vector<NodeId> old_ids;
+    old_ids.reserve(node_count());
+
+    switch (order) {
+        case NodeOrder::REVERSE_POSTORDER: {
+            TraversalState& state = edit_state_;
+            const NodeId roots[] = {START_ID};
+
+            old_ids = reachable_in_topological_order_(state, successors_, roots);
+            break;
+        }
+
+        case NodeOrder::BREADTH_FIRST: {
+            std::vector<bool> visited(node_count(), false);
+            visited[START_ID] = true;
+            old_ids.push_back(START_ID);
+
+            // old_ids is the queue
+            for (size_t head = 0; head < old_ids.size(); head++) {
+                timer.add_nodes(1);
+                timer.add_edges(successors_[old_ids[head]].size());
+
+                for (NodeId child: successors_[old_ids[head]]) {
+                    if (!visited[child]) {
+                        visited[child] = true;
+                        old_ids.push_back(child);
+                    }
+                }
+            }
+            break;
+        }
+
+        default:
+            assert(0 && "Unknown node order");
+            break;
+    }
+
+    std::vector<NodeId> new_ids(node_count(), INVALID_NODE);
+
+    // Start and End stay at their ids, End is moved out of the traversal order
+    new_ids[START_ID] = START_ID;
+    new_ids[END_ID]   = END_ID;
+    NodeId next_id = END_ID + 1;
+
+    for (NodeId node: old_ids) {
+        if (new_ids[node] == INVALID_NODE)
+            new_ids[node] = next_id++;
+    }
+
+    // Nodes unreachable from Start follow in their old relative order
+    for (NodeId node = 0; node < node_count(); node++) {
+        if (new_ids[node] == INVALID_NODE)
+            new_ids[node] = next_id++;
+    }
+
+    assert(next_id == node_count());
+
+    std::vector<NodeId> permutation(node_count());
+    for (NodeId node = 0; node < node_count(); node++)
+        permutation[new_ids[node]] = node;
+
+    std::vector<Adjacency::Edge> edges;
+    edges.reserve(successors_.edge_count());
+
+    std::vector<NodeIdx> new_indexes;
+    new_indexes.reserve(node_count());
+
+    for (NodeId node: permutation) {
+        new_indexes.push_back(indexes_[node]);
+
+        for (NodeId child: successors_[node])
+            edges.emplace_back(new_ids[node], new_ids[child]);
+    }
+
+    indexes_      = std::move(new_indexes);
+    successors_   = Adjacency(indexes_.size(), edges);
+    predecessors_ = successors_.reversed();
+
+    std::unordered_map<NodeId, std::vector<NodeIdx>> condensed_indexes;
+    for (auto& [node, node_indexes]: condensed_indexes_)
+        condensed_indexes.emplace(new_ids[node], std::move(node_indexes));
+
+    condensed_indexes_ = std::move(condensed_indexes);
+
+    for (NodeId& node: topological_order_)
+        node = new_ids[node];
+
+    index_nodes_();
+
+    drop_cached_analyses_();
+
+    dominators_     = ImmediateDominators();
+    postdominators_ = ImmediateDominators();
+
+    return new_ids;
+}
+
+std::span<const NodeIdx> DAGraph::condensed_indexes(NodeId node) const {
+    auto found = condensed_indexes_.find(node);
+
+    return found == condensed_indexes_.end() ? std::span<const NodeIdx>() : found->second;
+}
+
+size_t DAGraph::find_and_break_loops() {
+    PhaseTimer timer("find_and_break_loops");
+
+    std::vector<size_t> back_edges;
+
+    TraversalState& state = edit_state_;
+    state.begin(node_count());
+
+    // Loops without entries are unreachable from Start
     size_t loop_count = 0;
-    if ((loop_count = find_and_break_loops()) != 0)
-        throw loops_detected(std::to_string(loop_count));
+    for (NodeId node = START_ID; node < node_count(); node++) {
+        if (state.status(node) == UNVISITED)
+            loop_count += count_and_break_loops_traversal_(state, node, &back_edges);
+    }
+
+    successors_.remove_edges(back_edges);
+    predecessors_ = successors_.reversed();
+
+    return loop_count;
 }
 
-void DAGraph::topological_sort() {
-    std::vector<std::weak_ptr<Node>> stack;
-    start_->topological_sort_traversal(&stack, traversal_counter_);
-    traversal_counter_ += Node::VISITED;
+void DAGraph::add_edge(NodeId parent, NodeId child) {
+    check_edit_endpoints_(parent, child);
+
+    TraversalState& state = edit_state_;
+    std::vector<NodeId> reachable = reachable_in_topological_order_(state, successors_, std::span(&child, 1));
+    if (parent == child || std::find(reachable.begin(), reachable.end(), parent) != reachable.end())
+        throw loops_detected(std::format("Edge {} -> {} creates a loop", indexes_[parent], indexes_[child]));
 
-    for (size_t i = 1; i <= stack.size(); i++) {
-        std::shared_ptr<Node> node = stack[stack.size() - i].lock();
-        node->set_index(i);
+    std::vector<NodeId> sources = {parent};
+    std::vector<NodeId> targets = {child};
+
+    if (successors_.erase_edge(parent, END_ID)) {
+        predecessors_.erase_edge(END_ID, parent);
+        targets.push_back(END_ID);
+    }
+
+    if (predecessors_.erase_edge(child, START_ID)) {
+        successors_.erase_edge(START_ID, child);
+        sources.push_back(START_ID);
+    }
+
+    successors_.insert_edge(parent, child);
+    predecessors_.insert_edge(child, parent);
+
+    update_after_edit_(sources, targets);
+}
+
+void DAGraph::remove_edge(NodeId parent, NodeId child) {
+    check_edit_endpoints_(parent, child);
+
+    if (!successors_.erase_edge(parent, child))
+        throw edit_error(std::format("There is no edge {} -> {}", indexes_[parent], indexes_[child]));
+    predecessors_.erase_edge(child, parent);
+
+    std::vector<NodeId> sources = {parent};
+    std::vector<NodeId> targets = {child};
+
+    if (successors_[parent].empty()) {
+        successors_.insert_edge(parent, END_ID);
+        predecessors_.insert_edge(END_ID, parent);
+        targets.push_back(END_ID);
+    }
+
+    if (predecessors_[child].empty()) {
+        successors_.insert_edge(START_ID, child);
+        predecessors_.insert_edge(child, START_ID);
+        sources.push_back(START_ID);
+    }
+
+    update_after_edit_(sources, targets);
+}
+
+void DAGraph::check_edit_endpoints_(NodeId parent, NodeId child) const {
+    for (NodeId node: {parent, child}) {
+        if (node >= node_count())
+            throw edit_error(std::format("Unknown node id {}", node));
+
+        if (node == START_ID || node == END_ID)
+            throw edit_error("Start and End edges can't be edited");
+    }
+}
+
+void DAGraph::drop_cached_analyses_() {
+    topological_levels_ = TopologicalLevels();
+
+    dominator_sets_     = DominatorSets();
+    postdominator_sets_ = DominatorSets();
+
+    dominance_frontiers_     = Adjacency();
+    postdominance_frontiers_ = Adjacency();
+
+    cache_flags_ = std::make_unique<CacheFlags>();
+}
+
+void DAGraph::update_after_edit_(std::span<const NodeId> sources, std::span<const NodeId> targets) {
+    topological_order_.clear();
+    drop_cached_analyses_();
+
+    TraversalState& state = edit_state_;
+
+    // Only nodes reachable from changed edges can get another idom
+    if (!dominators_.idom.empty()) {
+        PhaseTimer timer("dominator_update");
+        std::vector<NodeId> affected = reachable_in_topological_order_(state, successors_, targets);
+
+        if (affected.size() > node_count() / FULL_UPDATE_FRACTION)
+            dominators_ = compute_immediate_dominators(successors_, predecessors_, START_ID);
+        else
+            update_immediate_dominators(predecessors_, affected, &dominators_);
+    }
+
+    if (!postdominators_.idom.empty()) {
+        PhaseTimer timer("postdominator_update");
+        std::vector<NodeId> affected = reachable_in_topological_order_(state, predecessors_, sources);
+
+        if (affected.size() > node_count() / FULL_UPDATE_FRACTION)
+            postdominators_ = compute_immediate_dominators(predecessors_, successors_, END_ID);
+        else
+            update_immediate_dominators(successors_, affected, &postdominators_);
     }
 }
 
-bool DAGraph::topological_sort_check() {
-    bool result = start_->topological_sort_check_traversal(traversal_counter_);
-    traversal_counter_ += Node::VISITED;
-    return result;
+std::vector<NodeId> DAGraph::reachable_from(std::span<const NodeId> roots, TraversalState& state) const {
+    return reachable_in_topological_order_(state, successors_, roots);
+}
+
+// Reverse postorder of DFS from roots
+std::vector<NodeId> DAGraph::reachable_in_topological_order_(TraversalState& state, const Adjacency& edges,
+                                                             std::span<const NodeId> roots) const {
+    state.begin(node_count());
+
+    assert(state.stack().empty());
+
+    std::vector<NodeId> postorder;
+    size_t edges_visited = 0;
+
+    for (NodeId root: roots) {
+        if (state.status(root) != UNVISITED)
+            continue;
+
+        state.set_status(root, VISITED);
+        state.stack().push_back({root, 0});
+
+        while (!state.stack().empty()) {
+            auto& [node, next_child] = state.stack().back();
+            std::span<const NodeId> children = edges[node];
+
+            if (next_child == children.size()) {
+                postorder.push_back(node);
+                state.stack().pop_back();
+                continue;
+            }
+
+            NodeId child = children[next_child++];
+            edges_visited++;
+
+            if (state.status(child) != UNVISITED)
+                continue;
+
+            state.set_status(child, VISITED);
+            state.stack().push_back({child, 0});
+        }
+    }
+
+    count_visited(postorder.size(), edges_visited);
+
+    std::reverse(postorder.begin(), postorder.end());
+
+    return postorder;
 }
 
-DomTree DAGraph::build_dominator_tree() {
-    start_->build_dominator_sets_traversal_({});
+// Kahn order is timed as the topological_levels phase. A cached order is only renumbered
+void DAGraph::topological_sort(TopoSortAlgorithm algorithm, size_t thread_count) {
+    if (topological_order_.empty()) {
+        switch (algorithm) {
+            case TopoSortAlgorithm::KAHN:
+                topological_order_ = topological_levels(thread_count).order;
+                break;
+
+            case TopoSortAlgorithm::DFS: {
+                PhaseTimer timer("topological_sort_dfs");
+
+                TraversalState& state = edit_state_;
+                state.begin(node_count());
+                topological_sort_traversal_(state, START_ID, &topological_order_);
+
+                std::reverse(topological_order_.begin(), topological_order_.end());
+                break;
+            }
+
+            default:
+                assert(0 && "Unknown topological sort algorithm");
+                break;
+        }
+    }
+
+    NodeIdx index = 1;
+    for (NodeId node: topological_order_) {
+        if (node != START_ID && node != END_ID)
+            indexes_[node] = index++;
+    }
+
+    index_nodes_();
+}
+
+namespace {
+
+// Branchless over a node's edges, so the inner loop can be vectorized
+std::optional<Adjacency::Edge> find_order_violation_in_range(const Adjacency& successors,
+                                                             std::span<const NodeIdx> indexes,
+                                                             NodeId begin, NodeId end) {
+    for (NodeId node = begin; node < end; node++) {
+        const NodeIdx index = indexes[node];
+        std::span<const NodeId> children = successors[node];
+
+        bool violated = false;
+        for (NodeId child: children)
+            violated |= indexes[child] <= index;
+
+        if (!violated)
+            continue;
+
+        for (NodeId child: children) {
+            if (indexes[child] <= index)
+                return Adjacency::Edge(node, child);
+        }
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+std::optional<Adjacency::Edge> DAGraph::find_topological_order_violation(size_t thread_count) const {
+    assert(thread_count > 0);
+
+    const NodeId end = static_cast<NodeId>(node_count());
+
+    if (thread_count == 1)
+        return find_order_violation_in_range(successors_, indexes_, 0, end);
+
+    std::vector<NodeId> range_begins = {0};
+
+    if (successors_.is_compact()) {
+        // Node ranges with roughly equal edge counts
+        std::span<const size_t> offsets = successors_.offsets();
+
+        for (size_t part = 1; part < thread_count; part++) {
+            size_t edge = successors_.edge_count() * part / thread_count;
+            NodeId node = static_cast<NodeId>(std::upper_bound(offsets.begin(), offsets.end(), edge) -
+                                              offsets.begin() - 1);
+
+            range_begins.push_back(std::max(std::min(node, end), range_begins.back()));
+        }
+    } else {
+        // Edited graphs have no edge offsets, split them by node counts
+        for (size_t part = 1; part < thread_count; part++)
+            range_begins.push_back(static_cast<NodeId>(end * part / thread_count));
+    }
+    range_begins.push_back(end);
+
+    std::vector<std::optional<Adjacency::Edge>> violations(thread_count);
+    {
+        std::vector<std::jthread> workers;
+
+        for (size_t part = 0; part < thread_count; part++) {
+            workers.emplace_back([&, part]() {
+                violations[part] = find_order_violation_in_range(successors_, indexes_,
+                                                                 range_begins[part], range_begins[part + 1]);
+            });
+        }
+    }
+
+    for (const auto& violation: violations) {
+        if (violation.has_value())
+            return violation;
+    }
+
+    return std::nullopt;
+}
+
+const TopologicalLevels& DAGraph::topological_levels(size_t thread_count) const {
+    std::call_once(cache_flags_->topological_levels, [&]() {
+        PhaseTimer timer("topological_levels");
+        topological_levels_ = compute_topological_levels(successors_, predecessors_, thread_count);
+    });
+
+    return topological_levels_;
+}
+
+DomTree DAGraph::build_dominator_tree(DomAlgorithm algorithm, size_t thread_count) const {
+    switch (algorithm) {
+        case DomAlgorithm::SEMI_NCA:
+        case DomAlgorithm::LEVELS:
+            return build_tree_from_idoms_(DomTree::DomType::DOMINATOR,
+                                          immediate_dominators_(algorithm, thread_count));
+
+        case DomAlgorithm::DOMINATOR_BITSETS:
+            return DomTree(DomTree::DomType::DOMINATOR, dominator_sets().immediate_dominators(),
+                           indexes_, generate_dot_images_);
+
+        case DomAlgorithm::DOMINATOR_SETS:
+            return build_dominator_tree_sets_();
+
+        default:
+            assert(0 && "Unknown dominator algorithm");
+            return build_dominator_tree_sets_();
+    }
+}
+
+DomTree DAGraph::build_postdominator_tree(DomAlgorithm algorithm, size_t thread_count) const {
+    switch (algorithm) {
+        case DomAlgorithm::SEMI_NCA:
+        case DomAlgorithm::LEVELS:
+            return build_tree_from_idoms_(DomTree::DomType::POSTDOMINATOR,
+                                          immediate_postdominators_(algorithm, thread_count));
+
+        case DomAlgorithm::DOMINATOR_BITSETS:
+            return DomTree(DomTree::DomType::POSTDOMINATOR, postdominator_sets().immediate_dominators(),
+                           indexes_, generate_dot_images_);
+
+        case DomAlgorithm::DOMINATOR_SETS:
+            return build_postdominator_tree_sets_();
+
+        default:
+            assert(0 && "Unknown dominator algorithm");
+            return build_postdominator_tree_sets_();
+    }
+}
+
+const ImmediateDominators& DAGraph::immediate_dominators() const {
+    return immediate_dominators_(DomAlgorithm::SEMI_NCA, 1);
+}
+
+const ImmediateDominators& DAGraph::immediate_postdominators() const {
+    return immediate_postdominators_(DomAlgorithm::SEMI_NCA, 1);
+}
+
+// Idoms survive edits, only their order has to be recomputed then
+const ImmediateDominators& DAGraph::immediate_dominators_(DomAlgorithm algorithm, size_t thread_count) const {
+    assert(algorithm == DomAlgorithm::SEMI_NCA || algorithm == DomAlgorithm::LEVELS);
+
+    std::call_once(cache_flags_->dominators, [&]() {
+        if (dominators_.idom.empty()) {
+            const TopologicalLevels* levels =
+                algorithm == DomAlgorithm::LEVELS ? &topological_levels(thread_count) : nullptr;
+
+            PhaseTimer timer("immediate_dominators");
+            dominators_ = levels ? compute_immediate_dominators_by_levels(predecessors_, *levels, START_ID,
+                                                                          false, thread_count)
+                                 : compute_immediate_dominators(successors_, predecessors_, START_ID);
+        } else if (dominators_.order.empty())
+            compute_dominator_order(&dominators_);
+    });
+
+    return dominators_;
+}
+
+// Levels of the graph reversed are the same levels in reversed order
+const ImmediateDominators& DAGraph::immediate_postdominators_(DomAlgorithm algorithm,
+                                                              size_t thread_count) const {
+    assert(algorithm == DomAlgorithm::SEMI_NCA || algorithm == DomAlgorithm::LEVELS);
+
+    std::call_once(cache_flags_->postdominators, [&]() {
+        if (postdominators_.idom.empty()) {
+            const TopologicalLevels* levels =
+                algorithm == DomAlgorithm::LEVELS ? &topological_levels(thread_count) : nullptr;
+
+            PhaseTimer timer("immediate_postdominators");
+            postdominators_ = levels ? compute_immediate_dominators_by_levels(successors_, *levels, END_ID,
+                                                                              true, thread_count)
+                                     : compute_immediate_dominators(predecessors_, successors_, END_ID);
+        } else if (postdominators_.order.empty())
+            compute_dominator_order(&postdominators_);
+    });
+
+    return postdominators_;
+}
+
+const DominatorSets& DAGraph::dominator_sets() const {
+    std::call_once(cache_flags_->dominator_sets, [this]() {
+        const std::vector<NodeId>& order = topological_levels().order;
+
+        PhaseTimer timer("dominator_sets");
+        dominator_sets_ = DominatorSets(predecessors_, order);
+    });
+
+    return dominator_sets_;
+}
+
+const DominatorSets& DAGraph::postdominator_sets() const {
+    std::call_once(cache_flags_->postdominator_sets, [this]() {
+        std::vector<NodeId> order(topological_levels().order.rbegin(), topological_levels().order.rend());
+
+        PhaseTimer timer("postdominator_sets");
+        postdominator_sets_ = DominatorSets(successors_, order);
+    });
+
+    return postdominator_sets_;
+}
+
+const Adjacency& DAGraph::dominance_frontiers() const {
+    std::call_once(cache_flags_->dominance_frontiers, [this]() {
+        const ImmediateDominators& doms = immediate_dominators();
+
+        PhaseTimer timer("dominance_frontiers");
+        dominance_frontiers_ = compute_dominance_frontiers(predecessors_, doms);
+    });
+
+    return dominance_frontiers_;
+}
+
+const Adjacency& DAGraph::postdominance_frontiers() const {
+    std::call_once(cache_flags_->postdominance_frontiers, [this]() {
+        const ImmediateDominators& doms = immediate_postdominators();
+
+        PhaseTimer timer("postdominance_frontiers");
+        postdominance_frontiers_ = compute_dominance_frontiers(successors_, doms);
+    });
+
+    return postdominance_frontiers_;
+}
+
+DomTree DAGraph::build_tree_from_idoms_(DomTree::DomType dom_type, const ImmediateDominators& doms) const {
+    return DomTree(dom_type, doms.idom, indexes_, generate_dot_images_);
+}
+
+DomTree DAGraph::build_dominator_tree_sets_() const {
+    TraversalState state;
+
+    // Sets shrink while paths are walked, the pool reuses freed nodes and drops them all at once
+    std::pmr::unsynchronized_pool_resource pool;
+    std::pmr::vector<NodeIdxSet> dominators(node_count(), &pool);
+    {
+        state.begin(node_count());
+        PhaseTimer timer("dominator_set_walk");
+        build_dominator_sets_traversal_(state, &dominators);
+    }
 
     DomTree dom_tree(DomTree::DomType::DOMINATOR, generate_dot_images_);
 
-    start_->build_dominator_tree_traversal_(&dom_tree, traversal_counter_);
-    traversal_counter_ += Node::VISITED;
+    PhaseTimer timer("dom_tree_insertion");
+
+    state.begin(node_count());
+    build_dominator_tree_traversal_(state, &dom_tree, dominators);
 
     return dom_tree;
 }
 
-DomTree DAGraph::build_postdominator_tree() {
-    start_->build_postdominator_sets_traversal_();
+DomTree DAGraph::build_postdominator_tree_sets_() const {
+    TraversalState state;
+
+    std::pmr::unsynchronized_pool_resource pool;
+    std::pmr::vector<NodeIdxSet> postdominators(node_count(), &pool);
+    {
+        state.begin(node_count());
+        PhaseTimer timer("postdominator_set_walk");
+        build_postdominator_sets_traversal_(state, &postdominators);
+    }
 
     DomTree postdom_tree(DomTree::DomType::POSTDOMINATOR, generate_dot_images_);
 
-    start_->build_postdominator_tree_traversal_(&postdom_tree, traversal_counter_);
-    traversal_counter_ += Node::VISITED;
+    PhaseTimer timer("postdom_tree_insertion");
+
+    state.begin(node_count());
+    build_postdominator_tree_traversal_(state, &postdom_tree, postdominators);
 
     return postdom_tree;
 }
 
-void DAGraph::Node::build_dominator_sets_traversal_(const std::set<NodeIdx>& parent_set) {
-    if (dominators_.empty()) {
-        dominators_ = parent_set;
-        dominators_.insert(index_);
-    } else {
-        std::erase_if(dominators_, [this, parent_set](NodeIdx index){
-                return !(index == index_ || parent_set.contains(index));
-            });
+void DAGraph::dump_traversal_entry_(DotWriter& writer, TraversalState& state) const {
+    state.begin(node_count());
+    dump_subtree_traversal_(writer, state, START_ID);
+}
+
+void DAGraph::dump_subtree_traversal_(DotWriter& writer, TraversalState& state, NodeId root) const {
+    assert(state.stack().empty());
+
+    state.set_status(root, VISITED);
+    writer.node(indexes_[root]);
+    state.stack().push_back({root, 0});
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
+
+        if (next_child == children.size()) {
+            writer.text("\n");
+            state.stack().pop_back();
+            continue;
+        }
+
+        NodeId child = children[next_child++];
+        writer.edge(indexes_[node], indexes_[child]);
+
+        if (state.status(child) != UNVISITED)
+            continue;
+
+        state.set_status(child, VISITED);
+        writer.node(indexes_[child]);
+        state.stack().push_back({child, 0});
+    }
+}
+
+void DAGraph::dump_neighborhood(std::filesystem::path path, std::span<const NodeId> nodes,
+                                size_t radius, ImageRenderer* renderer) const {
+    dump_(std::move(path), renderer, [&](DotWriter& writer, TraversalState& state) {
+        dump_neighborhood_(writer, state, nodes, radius);
+    });
+}
+
+void DAGraph::dump_collapsed(std::filesystem::path path, ImageRenderer* renderer) const {
+    dump_(std::move(path), renderer, [this](DotWriter& writer, TraversalState&) { dump_collapsed_(writer); });
+}
+
+NodeId DAGraph::find_node(NodeIdx index) const {
+    auto found = node_ids_.find(index);
+
+    return found == node_ids_.end() ? INVALID_NODE : found->second;
+}
+
+void DAGraph::index_nodes_() {
+    node_ids_.clear();
+    node_ids_.reserve(indexes_.size());
+
+    for (NodeId node = 0; node < indexes_.size(); node++)
+        node_ids_.emplace(indexes_[node], node);
+}
+
+// Breadth-first over both edge directions, dumped nodes stay VISITED until the traversal is finished
+void DAGraph::dump_neighborhood_(DotWriter& writer, TraversalState& state, std::span<const NodeId> nodes,
+                                 size_t radius) const {
+    state.begin(node_count());
+
+    std::vector<NodeId> dumped;
+
+    for (NodeId node: nodes) {
+        assert(node < node_count());
+
+        if (state.status(node) == UNVISITED) {
+            state.set_status(node, VISITED);
+            dumped.push_back(node);
+        }
     }
 
-    for (auto child: children_)
-        child->build_dominator_sets_traversal_(dominators_);
+    size_t layer_begin = 0;
+    for (size_t distance = 0; distance < radius && layer_begin < dumped.size(); distance++) {
+        const size_t layer_end = dumped.size();
+
+        for (size_t i = layer_begin; i < layer_end; i++) {
+            for (const Adjacency* edges: {&successors_, &predecessors_}) {
+                for (NodeId neighbour: (*edges)[dumped[i]]) {
+                    if (state.status(neighbour) != UNVISITED)
+                        continue;
+
+                    state.set_status(neighbour, VISITED);
+                    dumped.push_back(neighbour);
+                }
+            }
+        }
+
+        layer_begin = layer_end;
+    }
+
+    auto is_dumped = [&state](NodeId node) { return state.status(node) == VISITED; };
+
+    for (NodeId node: dumped) {
+        const bool truncated = !std::ranges::all_of(successors_[node], is_dumped) ||
+                               !std::ranges::all_of(predecessors_[node], is_dumped);
+        writer.node(indexes_[node], truncated);
+    }
+
+    writer.text("\n");
+
+    for (NodeId node: dumped) {
+        for (NodeId child: successors_[node]) {
+            if (is_dumped(child))
+                writer.edge(indexes_[node], indexes_[child]);
+        }
+    }
 }
 
-const std::set<NodeIdx>& DAGraph::Node::build_postdominator_sets_traversal_() {
-    for (auto child: children_) {
-        const std::set<NodeIdx>& child_set = child->build_postdominator_sets_traversal_();
+bool DAGraph::is_chain_link_(NodeId node) const {
+    if (node == END_ID || predecessors_[node].size() != 1)
+        return false;
+
+    NodeId parent = predecessors_[node][0];
+
+    return parent != START_ID && successors_[parent].size() == 1;
+}
 
-        if (postdominators_.empty()) {
-            postdominators_ = child_set;
-            postdominators_.insert(index_);
+// Chains are named after their first node, so edges into a chain lead to its box
+void DAGraph::dump_collapsed_(DotWriter& writer) const {
+    for (NodeId first = 0; first < node_count(); first++) {
+        if (is_chain_link_(first))
+            continue;
+
+        NodeId last = first;
+        size_t length = 1;
+
+        while (successors_[last].size() == 1 && is_chain_link_(successors_[last][0])) {
+            last = successors_[last][0];
+            length++;
+        }
+
+        if (length == 1)
+            writer.node(indexes_[first]);
+        else
+            writer.chain(indexes_[first], indexes_[last], length);
+
+        for (NodeId child: successors_[last])
+            writer.edge(indexes_[first], indexes_[child]);
+    }
+}
+
+// Walks every path from Start, so the stack holds the current path
+void DAGraph::build_dominator_sets_traversal_(TraversalState& state,
+                                              std::pmr::vector<NodeIdxSet>* dominators) const {
+    assert(dominators);
+    assert(state.stack().empty());
+
+    size_t nodes_visited = 1;
+    size_t edges_visited = 0;
+
+    (*dominators)[START_ID] = {indexes_[START_ID]};
+    state.stack().push_back({START_ID, 0});
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
+
+        if (next_child == children.size()) {
+            state.stack().pop_back();
+            continue;
+        }
+
+        NodeId child = children[next_child++];
+        nodes_visited++;
+        edges_visited++;
+
+        const NodeIdxSet& parent_set = (*dominators)[node];
+        NodeIdxSet& child_set = (*dominators)[child];
+        const NodeIdx index = indexes_[child];
+
+        if (child_set.empty()) {
+            child_set = parent_set;
+            child_set.insert(index);
         } else {
-            std::erase_if(postdominators_, [this, child_set](NodeIdx index){
-                    return !(index == index_ || child_set.contains(index));
+            std::erase_if(child_set, [index, &parent_set](NodeIdx other){
+                    return !(other == index || parent_set.contains(other));
                 });
         }
+
+        state.stack().push_back({child, 0});
     }
-    if (children_.size() == 0)
-        postdominators_.insert(index_);
 
-    return postdominators_;
+    count_visited(nodes_visited, edges_visited);
 }
 
-void DAGraph::Node::build_dominator_tree_traversal_(DomTree* dom_tree, size_t traversal_counter) {
-    assert(dom_tree);
-    if (traversal_status_(traversal_counter) != UNVISITED) {
-        assert(traversal_status_(traversal_counter) == VISITED);
-        return;
+// Walks every path from Start, child sets are merged into the parent when the child frame is popped
+void DAGraph::build_postdominator_sets_traversal_(TraversalState& state,
+                                                  std::pmr::vector<NodeIdxSet>* postdominators) const {
+    assert(postdominators);
+    assert(state.stack().empty());
+
+    size_t nodes_visited = 1;
+    size_t edges_visited = 0;
+
+    state.stack().push_back({START_ID, 0});
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
+
+        if (next_child < children.size()) {
+            state.stack().push_back({children[next_child++], 0});
+            nodes_visited++;
+            edges_visited++;
+            continue;
+        }
+
+        const NodeId child = node;
+        state.stack().pop_back();
+
+        if (children.size() == 0)
+            (*postdominators)[child].insert(indexes_[child]);
+
+        if (state.stack().empty())
+            break;
+
+        const NodeId parent = state.stack().back().node;
+        const NodeIdxSet& child_set = (*postdominators)[child];
+        NodeIdxSet& parent_set = (*postdominators)[parent];
+        const NodeIdx index = indexes_[parent];
+
+        if (parent_set.empty()) {
+            parent_set = child_set;
+            parent_set.insert(index);
+        } else {
+            std::erase_if(parent_set, [index, &child_set](NodeIdx other){
+                    return !(other == index || child_set.contains(other));
+                });
+        }
     }
-    traversal_counter_ = traversal_counter + VISITED;
 
-    dom_tree->add_node_with_dominators(index_, dominators_);
+    count_visited(nodes_visited, edges_visited);
+}
+
+void DAGraph::build_dominator_tree_traversal_(TraversalState& state, DomTree* dom_tree,
+                                              const std::pmr::vector<NodeIdxSet>& dominators) const {
+    assert(dom_tree);
+    assert(state.stack().empty());
+
+    size_t nodes_visited = 1;
+    size_t edges_visited = 0;
+
+    state.set_status(START_ID, VISITED);
+    dom_tree->add_node_with_dominators(indexes_[START_ID], dominators[START_ID]);
+    state.stack().push_back({START_ID, 0});
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
+
+        if (next_child == children.size()) {
+            state.stack().pop_back();
+            continue;
+        }
+
+        NodeId child = children[next_child++];
+        edges_visited++;
+
+        if (state.status(child) != UNVISITED) {
+            assert(state.status(child) == VISITED);
+            continue;
+        }
+        state.set_status(child, VISITED);
+        nodes_visited++;
+
+        dom_tree->add_node_with_dominators(indexes_[child], dominators[child]);
+        state.stack().push_back({child, 0});
+    }
 
-    for (auto child: children_)
-        child->build_dominator_tree_traversal_(dom_tree, traversal_counter);
+    count_visited(nodes_visited, edges_visited);
 }
 
-void DAGraph::Node::build_postdominator_tree_traversal_(DomTree* postdom_tree, size_t traversal_counter) {
+void DAGraph::build_postdominator_tree_traversal_(TraversalState& state, DomTree* postdom_tree,
+                                                  const std::pmr::vector<NodeIdxSet>& postdominators) const {
     assert(postdom_tree);
-    if (traversal_status_(traversal_counter) != UNVISITED) {
-        assert(traversal_status_(traversal_counter) == VISITED);
-        return;
-    }
-    traversal_counter_ = traversal_counter + VISITED;
+    assert(state.stack().empty());
 
-    for (auto child: children_)
-        child->build_postdominator_tree_traversal_(postdom_tree, traversal_counter);
+    size_t nodes_visited = 1;
+    size_t edges_visited = 0;
 
-    postdom_tree->add_node_with_dominators(index_, postdominators_);
-}
+    state.set_status(START_ID, VISITED);
+    state.stack().push_back({START_ID, 0});
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
+
+        if (next_child == children.size()) {
+            postdom_tree->add_node_with_dominators(indexes_[node], postdominators[node]);
+            state.stack().pop_back();
+            continue;
+        }
 
-size_t DAGraph::Node::count_and_break_loops_traversal(size_t traversal_counter) {
-    assert(traversal_status_(traversal_counter) == UNVISITED);
+        NodeId child = children[next_child++];
+        edges_visited++;
 
-    traversal_counter_ = traversal_counter + VISITING;
+        if (state.status(child) != UNVISITED) {
+            assert(state.status(child) == VISITED);
+            continue;
+        }
+        state.set_status(child, VISITED);
+        nodes_visited++;
+
+        state.stack().push_back({child, 0});
+    }
+
+    count_visited(nodes_visited, edges_visited);
+}
+
+size_t DAGraph::count_and_break_loops_traversal_(TraversalState& state, NodeId root,
+                                                 std::vector<size_t>* back_edges) const {
+    assert(back_edges);
+    assert(state.stack().empty());
+    assert(state.status(root) == UNVISITED);
 
     size_t loop_count = 0;
+    size_t nodes_visited = 1;
+    size_t edges_visited = 0;
 
-    for (size_t i = 0; i < children_.size(); i++) {
-        switch (children_[i]->traversal_status_(traversal_counter)) {
+    state.set_status(root, VISITING);
+    state.stack().push_back({root, 0});
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
+
+        if (next_child == children.size()) {
+            state.set_status(node, VISITED);
+            state.stack().pop_back();
+            continue;
+        }
+
+        size_t child_num = next_child++;
+        NodeId child = children[child_num];
+        edges_visited++;
+
+        switch (state.status(child)) {
             case UNVISITED:
-                loop_count += children_[i]->count_and_break_loops_traversal(traversal_counter);
+                state.set_status(child, VISITING);
+                nodes_visited++;
+                state.stack().push_back({child, 0});
                 break;
 
             case VISITING:
-                children_[i] = nullptr;
+                back_edges->push_back(successors_.first_edge(node) + child_num);
                 loop_count += 1;
                 break;
 
@@ -202,62 +1345,50 @@ size_t DAGraph::Node::count_and_break_loops_traversal(size_t traversal_counter)
         }
     }
 
-    traversal_counter_ = traversal_counter + VISITED;
+    count_visited(nodes_visited, edges_visited);
+
     return loop_count;
 }
 
-void DAGraph::Node::topological_sort_traversal(std::vector<std::weak_ptr<Node>>* stack, size_t traversal_counter) {
-    assert(stack);
+void DAGraph::topological_sort_traversal_(TraversalState& state, NodeId root,
+                                          std::vector<NodeId>* postorder) const {
+    assert(postorder);
+    assert(state.stack().empty());
 
-    switch (traversal_status_(traversal_counter)) {
-        case UNVISITED:
-            traversal_counter_ = traversal_counter + VISITED;
+    size_t edges_visited = 0;
 
-            for (auto child: children_) {
-                child->topological_sort_traversal(stack, traversal_counter);
+    state.set_status(root, VISITED);
+    state.stack().push_back({root, 0});
 
-                if (child->index_ != END)
-                    stack->push_back(child);
-            }
-
-            return;
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+        std::span<const NodeId> children = successors_[node];
 
-        case VISITED:
-            return;
-
-        case VISITING:
-        case INCORRECT:
-        default:
-            assert(0 && "DAGraph is corrupted");
-            return;
-    }
-}
+        if (next_child == children.size()) {
+            postorder->push_back(node);
+            state.stack().pop_back();
+            continue;
+        }
 
-bool DAGraph::Node::topological_sort_check_traversal(size_t traversal_counter) {
-    assert(traversal_status_(traversal_counter) == UNVISITED);
-    traversal_counter_ = traversal_counter + VISITED;
+        NodeId child = children[next_child++];
+        edges_visited++;
 
-    bool sorted = true;
-    for (auto child: children_) {
-        switch (child->traversal_status_(traversal_counter)) {
+        switch (state.status(child)) {
             case UNVISITED:
-                sorted |= child->topological_sort_check_traversal(traversal_counter);
+                state.set_status(child, VISITED);
+                state.stack().push_back({child, 0});
+                break;
 
-            [[fallthrough]];
             case VISITED:
-                sorted |= child->index_ < index_;
                 break;
 
             case VISITING:
             case INCORRECT:
             default:
                 assert(0 && "DAGraph is corrupted");
-                sorted = false;
                 break;
         }
     }
 
-    return sorted;
+    count_visited(postorder->size(), edges_visited);
 }
-
-
@@ -0,0 +1,263 @@
+#include "dom_tree.h"
+#include "adjacency.h"
+#include "dump.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <utility>
+#include <vector>
+
+using namespace graphs;
+
+DomTree::DomTree(DomType dom_type, bool generate_dot_images)
+    : DumpableGraph(generate_dot_images), node_count_(1),
+      indexes_{static_cast<NodeIdx>(dom_type)}, parents_{NO_NODE},
+      first_children_{NO_NODE}, next_siblings_{NO_NODE} {
+    positions_.emplace(indexes_[root_], root_);
+}
+
+DomTree::DomTree(DomType dom_type, std::span<const NodeId> idom, std::span<const NodeIdx> indexes,
+                 bool generate_dot_images)
+    : DumpableGraph(generate_dot_images), root_(NO_NODE),
+      indexes_(indexes.begin(), indexes.end()), parents_(idom.size(), NO_NODE),
+      first_children_(idom.size(), NO_NODE), next_siblings_(idom.size(), NO_NODE) {
+
+    assert(idom.size() == indexes.size());
+
+    PhaseTimer timer("dom_tree_build");
+    timer.add_nodes(idom.size());
+
+    // Backward pass keeps children in ascending position order
+    for (NodeId pos = static_cast<NodeId>(idom.size()); pos-- > 0;) {
+        const NodeId parent = idom[pos];
+        if (parent == INVALID_NODE)
+            continue;
+
+        node_count_++;
+
+        if (parent == pos) {
+            root_ = pos;
+            continue;
+        }
+
+        parents_[pos]         = parent;
+        next_siblings_[pos]   = first_children_[parent];
+        first_children_[parent] = pos;
+    }
+
+    assert(root_ != NO_NODE && indexes_[root_] == static_cast<NodeIdx>(dom_type));
+}
+
+void DomTree::add_node_with_dominators(NodeIdx index, const NodeIdxSet& dominators) {
+    if (index == indexes_[root_]) {
+        assert(dominators.size() == 1);
+        return;
+    }
+
+    NodeId node = root_;
+
+    for (bool descended = true; descended;) {
+        descended = false;
+
+        for (NodeId child = first_children_[node]; child != NO_NODE; child = next_siblings_[child]) {
+            if (dominators.contains(indexes_[child])) {
+                node = child;
+                descended = true;
+                break;
+            }
+        }
+    }
+
+    add_child_(node, index);
+}
+
+void DomTree::add_node_with_idom(NodeIdx index, NodeIdx idom) {
+    if (index == indexes_[root_]) {
+        assert(idom == index);
+        return;
+    }
+
+    NodeId idom_pos = position_(idom);
+    assert(idom_pos != NO_NODE);
+
+    add_child_(idom_pos, index);
+}
+
+std::map<NodeIdx, NodeIdx> DomTree::immediate_dominators() const {
+    std::map<NodeIdx, NodeIdx> idoms;
+
+    for (NodeId pos = 0; pos < parents_.size(); pos++) {
+        if (parents_[pos] != NO_NODE)
+            idoms.emplace(indexes_[pos], indexes_[parents_[pos]]);
+    }
+
+    return idoms;
+}
+
+NodeId DomTree::add_child_(NodeId parent, NodeIdx index) {
+    assert(position_(index) == NO_NODE);
+
+    const NodeId pos = static_cast<NodeId>(indexes_.size());
+
+    indexes_.push_back(index);
+    parents_.push_back(parent);
+    first_children_.push_back(NO_NODE);
+    next_siblings_.push_back(first_children_[parent]);
+    first_children_[parent] = pos;
+
+    positions_.emplace(index, pos);
+    node_count_++;
+
+    if (queries_ready_) {
+        queries_flag_ = std::make_unique<std::once_flag>();
+        queries_ready_ = false;
+    }
+
+    return pos;
+}
+
+void DomTree::sync_positions_() const {
+    if (positions_.size() == node_count_)
+        return;
+
+    positions_.clear();
+    positions_.reserve(node_count_);
+
+    for (NodeId pos = 0; pos < indexes_.size(); pos++) {
+        if (in_tree_(pos))
+            positions_.emplace(indexes_[pos], pos);
+    }
+}
+
+// Parent preorder numbers are kept in a sparse table: LCA of nodes with preorder numbers a < b
+// is the minimal parent number among preorder numbers a + 1 .. b
+void DomTree::build_query_numbering_() const {
+    PhaseTimer timer("dom_tree_query_numbering");
+    timer.add_nodes(node_count_);
+
+    preorder_numbers_.assign(indexes_.size(), NO_NODE);
+    subtree_ends_.assign(indexes_.size(), NO_NODE);
+
+    preorder_positions_.clear();
+    preorder_positions_.reserve(node_count_);
+
+    std::vector<NodeId> parent_numbers;
+    parent_numbers.reserve(node_count_);
+
+    // Links are enough for the walk: down to the first child, then to the next sibling or up
+    for (NodeId pos = root_; pos != NO_NODE;) {
+        preorder_numbers_[pos] = static_cast<NodeId>(preorder_positions_.size());
+        preorder_positions_.push_back(pos);
+        parent_numbers.push_back(pos == root_ ? 0 : preorder_numbers_[parents_[pos]]);
+
+        if (first_children_[pos] != NO_NODE) {
+            pos = first_children_[pos];
+            continue;
+        }
+
+        while (pos != NO_NODE) {
+            subtree_ends_[pos] = static_cast<NodeId>(preorder_positions_.size() - 1);
+
+            if (pos == root_) {
+                pos = NO_NODE;
+            } else if (next_siblings_[pos] != NO_NODE) {
+                pos = next_siblings_[pos];
+                break;
+            } else {
+                pos = parents_[pos];
+            }
+        }
+    }
+
+    const size_t size = parent_numbers.size();
+
+    lca_table_.assign(1, std::move(parent_numbers));
+    for (size_t width = 2; width <= size; width *= 2) {
+        const std::vector<NodeId>& prev = lca_table_.back();
+        std::vector<NodeId> level(size - width + 1);
+
+        for (size_t i = 0; i < level.size(); i++)
+            level[i] = std::min(prev[i], prev[i + width / 2]);
+
+        lca_table_.push_back(std::move(level));
+    }
+}
+
+NodeIdx DomTree::nearest_common_dominator(NodeIdx first, NodeIdx second) const {
+    auto [first_pos, second_pos] = query_positions_(first, second);
+
+    NodeId begin = preorder_numbers_[first_pos];
+    NodeId end   = preorder_numbers_[second_pos];
+
+    if (begin == end)
+        return first;
+
+    if (begin > end)
+        std::swap(begin, end);
+
+    begin++;
+
+    const size_t level = std::bit_width(end - begin + 1u) - 1;
+    const std::vector<NodeId>& mins = lca_table_[level];
+
+    return indexes_[preorder_positions_[std::min(mins[begin], mins[end + 1 - (size_t(1) << level)])]];
+}
+
+void DomTree::dump_subtree(std::filesystem::path path, NodeIdx root, size_t max_depth,
+                           ImageRenderer* renderer) const {
+    prepare_queries_();
+
+    NodeId root_pos = find_position_(root);
+    assert(root_pos != NO_NODE);
+
+    dump_(std::move(path), renderer, [&](DotWriter& writer, TraversalState& state) {
+        dump_subtree_traversal_(writer, state, root_pos, max_depth);
+    });
+}
+
+void DomTree::dump_traversal_entry_(DotWriter& writer, TraversalState& state) const {
+    dump_subtree_traversal_(writer, state, root_, NO_NODE);
+}
+
+// Tree nodes are reached once, so only the stack of the state is used
+void DomTree::dump_subtree_traversal_(DotWriter& writer, TraversalState& state, NodeId root,
+                                      size_t max_depth) const {
+    state.begin(0);
+
+    // Frames hold a node position and the position of its next child to dump.
+    // Stack size is the depth of the pushed node, children of max_depth nodes are skipped
+    auto push_node = [&](NodeId node) {
+        const bool cut_off = state.stack().size() == max_depth;
+
+        writer.node(indexes_[node], cut_off && first_children_[node] != NO_NODE);
+        state.stack().push_back({node, cut_off ? NO_NODE : first_children_[node]});
+    };
+
+    push_node(root);
+
+    while (!state.stack().empty()) {
+        auto& [node, next_child] = state.stack().back();
+
+        if (next_child == NO_NODE) {
+            writer.text("\n");
+            state.stack().pop_back();
+            continue;
+        }
+
+        const NodeId child = static_cast<NodeId>(next_child);
+        next_child = next_siblings_[child];
+
+        writer.edge(indexes_[node], indexes_[child]);
+        push_node(child);
+    }
+}
@@ -0,0 +1,100 @@
+#include "dominator_sets.h"
+#include "adjacency.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace graphs;
+
+namespace {
+
+void intersect_words(DominatorSets::Word* result, const DominatorSets::Word* other, size_t size) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 4 <= size; i += 4) {
+        __m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(result + i));
+        __m256i rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i), _mm256_and_si256(lhs, rhs));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= size; i += 2) {
+        __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(result + i));
+        __m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_and_si128(lhs, rhs));
+    }
+#endif
+
+    for (; i < size; i++)
+        result[i] &= other[i];
+}
+
+} // namespace
+
+DominatorSets::DominatorSets(const Adjacency& predecessors, std::span<const NodeId> order)
+    : words_per_set_((order.size() + WORD_BITS - 1) / WORD_BITS),
+      order_(order.begin(), order.end()),
+      positions_(order.size(), INVALID_NODE),
+      bits_(order.size() * words_per_set_, 0) {
+
+    assert(order.size() == predecessors.node_count());
+
+    for (size_t pos = 0; pos < order_.size(); pos++)
+        positions_[order_[pos]] = pos;
+
+    size_t edges_visited = 0;
+
+    for (size_t pos = 0; pos < order_.size(); pos++) {
+        const NodeId node = order_[pos];
+        Word* set = bits_.data() + node * words_per_set_;
+
+        std::span<const NodeId> preds = predecessors[node];
+        edges_visited += preds.size();
+        if (!preds.empty()) {
+            assert(positions_[preds.front()] < pos);
+            std::span<const Word> first = (*this)[preds.front()];
+            std::copy(first.begin(), first.end(), set);
+
+            for (NodeId pred: preds.subspan(1)) {
+                assert(positions_[pred] < pos);
+                intersect_words(set, bits_.data() + pred * words_per_set_, words_per_set_);
+            }
+        }
+
+        set[pos / WORD_BITS] |= Word(1) << (pos % WORD_BITS);
+    }
+
+    count_visited(order_.size(), edges_visited);
+}
+
+std::vector<NodeId> DominatorSets::immediate_dominators() const {
+    std::vector<NodeId> idom(node_count());
+
+    for (NodeId node = 0; node < node_count(); node++) {
+        std::span<const Word> set = (*this)[node];
+        const size_t pos = positions_[node];
+
+        // Highest bit below the node's own position
+        idom[node] = node;
+
+        size_t word_num = pos / WORD_BITS;
+        Word word = set[word_num] & ((Word(1) << (pos % WORD_BITS)) - 1);
+
+        while (word == 0 && word_num > 0)
+            word = set[--word_num];
+
+        if (word != 0)
+            idom[node] = order_[word_num * WORD_BITS + static_cast<size_t>(std::bit_width(word)) - 1];
+    }
+
+    return idom;
+}
@@ -0,0 +1,455 @@
+#include "dominators.h"
+#include "adjacency.h"
+#include "level_threads.h"
+#include "stats.h"
+#include "topological.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+using namespace graphs;
+
+namespace {
+
+// All arrays are indexed by DFS preorder numbers
+struct SemiNCAState {
+    std::vector<size_t> parent;
+    std::vector<size_t> ancestor;
+    std::vector<size_t> semi;
+    std::vector<size_t> label;
+    std::vector<size_t> idom;
+
+    std::vector<size_t> eval_stack;
+
+    explicit SemiNCAState(size_t size)
+        : parent(size), ancestor(size), semi(size), label(size), idom(size) {}
+
+    // Minimal semi label on the compressed path from node to the already linked forest root.
+    // Nodes with numbers >= last_linked are linked
+    size_t eval(size_t node, size_t last_linked);
+};
+
+size_t SemiNCAState::eval(size_t node, size_t last_linked) {
+    if (ancestor[node] < last_linked)
+        return label[node];
+
+    assert(eval_stack.empty());
+    do {
+        eval_stack.push_back(node);
+        node = ancestor[node];
+    } while (ancestor[node] >= last_linked);
+
+    size_t prev = node;
+    size_t prev_label = label[prev];
+    do {
+        node = eval_stack.back();
+        eval_stack.pop_back();
+
+        ancestor[node] = ancestor[prev];
+
+        if (semi[prev_label] < semi[label[node]])
+            label[node] = prev_label;
+        else
+            prev_label = label[node];
+
+        prev = node;
+    } while (!eval_stack.empty());
+
+    return label[node];
+}
+
+std::vector<size_t> dfs_numbering(const Adjacency& successors, NodeId root,
+                                  std::vector<NodeId>* preorder, std::vector<size_t>* parent,
+                                  size_t* edges_visited) {
+    assert(preorder && parent && edges_visited);
+
+    constexpr size_t UNNUMBERED = ~size_t(0);
+    std::vector<size_t> number(successors.node_count(), UNNUMBERED);
+
+    std::vector<std::pair<NodeId, size_t>> stack; //< node and index of the next child to visit
+
+    number[root] = 0;
+    preorder->push_back(root);
+    parent->push_back(0);
+    stack.emplace_back(root, 0);
+
+    while (!stack.empty()) {
+        auto& [node, next_child] = stack.back();
+        std::span<const NodeId> children = successors[node];
+
+        if (next_child == children.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        NodeId child = children[next_child++];
+        (*edges_visited)++;
+
+        if (number[child] != UNNUMBERED)
+            continue;
+
+        number[child] = preorder->size();
+        parent->push_back(number[node]);
+        preorder->push_back(child);
+        stack.emplace_back(child, 0);
+    }
+
+    return number;
+}
+
+// Jump pointer of a node whose idom already has one
+NodeId jump_target(const ImmediateDominators& doms, NodeId idom) {
+    const NodeId idom_jump = doms.jump[idom];
+
+    if (doms.depth[idom] - doms.depth[idom_jump] == doms.depth[idom_jump] - doms.depth[doms.jump[idom_jump]])
+        return doms.jump[idom_jump];
+
+    return idom;
+}
+
+// Ancestor of node at the given depth. Every step up is added to steps
+NodeId dominator_at_depth(const ImmediateDominators& doms, NodeId node, size_t depth, size_t* steps) {
+    assert(doms.depth[node] >= depth);
+    assert(steps);
+
+    while (doms.depth[node] > depth) {
+        node = doms.depth[doms.jump[node]] >= depth ? doms.jump[node] : doms.idom[node];
+        (*steps)++;
+    }
+
+    return node;
+}
+
+// Both nodes are lifted to the same depth, then they take jumps which don't meet yet.
+// Nodes of one depth have jumps to one depth, so both sides stay level
+NodeId nearest_common_dominator(const ImmediateDominators& doms, NodeId first, NodeId second, size_t* steps) {
+    assert(steps);
+
+    if (doms.depth[first] > doms.depth[second])
+        first = dominator_at_depth(doms, first, doms.depth[second], steps);
+    else
+        second = dominator_at_depth(doms, second, doms.depth[first], steps);
+
+    while (first != second) {
+        (*steps)++;
+
+        if (doms.jump[first] != doms.jump[second]) {
+            first  = doms.jump[first];
+            second = doms.jump[second];
+        } else {
+            first  = doms.idom[first];
+            second = doms.idom[second];
+        }
+    }
+
+    return first;
+}
+
+// Idoms of all reachable predecessors must be known. Only idom, depth and jump of node are written
+void set_idom_from_predecessors(const Adjacency& predecessors, NodeId node, ImmediateDominators* doms,
+                                size_t* nca_steps) {
+    assert(doms);
+
+    NodeId common = INVALID_NODE;
+    for (NodeId pred: predecessors[node]) {
+        if (doms->idom[pred] == INVALID_NODE)
+            continue;
+
+        common = common == INVALID_NODE ? pred : nearest_common_dominator(*doms, common, pred, nca_steps);
+    }
+
+    doms->idom[node] = common;
+
+    if (common == INVALID_NODE) {
+        doms->depth[node] = INVALID_NODE;
+        doms->jump[node]  = INVALID_NODE;
+    } else {
+        doms->depth[node] = doms->depth[common] + 1;
+        doms->jump[node]  = jump_target(*doms, common);
+    }
+}
+
+// Returns the number of predecessor edges visited
+size_t process_level(const Adjacency& predecessors, std::span<const NodeId> level, NodeId root,
+                     ImmediateDominators* doms, size_t* nca_steps) {
+    size_t edges_visited = 0;
+
+    for (NodeId node: level) {
+        if (node == root)
+            continue;
+
+        set_idom_from_predecessors(predecessors, node, doms, nca_steps);
+        edges_visited += predecessors[node].size();
+    }
+
+    return edges_visited;
+}
+
+// Predecessors are in previous levels, so nodes of one level are independent
+size_t process_level_parallel(const Adjacency& predecessors, std::span<const NodeId> level, NodeId root,
+                              ImmediateDominators* doms, size_t* nca_steps, LevelThreads* threads) {
+    assert(nca_steps && threads);
+
+    const size_t thread_count = threads->thread_count();
+    const size_t part_size = (level.size() + thread_count - 1) / thread_count;
+
+    std::vector<size_t> edges_visited(thread_count, 0);
+    std::vector<size_t> thread_nca_steps(thread_count, 0);
+
+    threads->run([&](size_t thread) {
+        size_t begin = std::min(thread * part_size, level.size());
+        size_t end   = std::min(begin + part_size, level.size());
+
+        edges_visited[thread] = process_level(predecessors, level.subspan(begin, end - begin), root, doms,
+                                              &thread_nca_steps[thread]);
+    });
+
+    *nca_steps += std::accumulate(thread_nca_steps.begin(), thread_nca_steps.end(), size_t(0));
+
+    return std::accumulate(edges_visited.begin(), edges_visited.end(), size_t(0));
+}
+
+} // namespace
+
+ImmediateDominators graphs::compute_immediate_dominators(const Adjacency& successors,
+                                                         const Adjacency& predecessors,
+                                                         NodeId root) {
+    assert(successors.node_count() == predecessors.node_count());
+    assert(root < successors.node_count());
+
+    ImmediateDominators result;
+
+    std::vector<size_t> parent;
+    size_t edges_visited = 0;
+    std::vector<size_t> number = dfs_numbering(successors, root, &result.order, &parent, &edges_visited);
+
+    const size_t size = result.order.size();
+    SemiNCAState state(size);
+
+    for (size_t i = 0; i < size; i++) {
+        state.parent[i] = state.ancestor[i] = state.idom[i] = parent[i];
+        state.semi[i] = state.label[i] = i;
+    }
+
+    for (size_t i = size - 1; i >= 1; i--) {
+        state.semi[i] = state.parent[i];
+        edges_visited += predecessors[result.order[i]].size();
+
+        for (NodeId pred: predecessors[result.order[i]]) {
+            if (number[pred] >= size) //< unreachable from root
+                continue;
+
+            size_t pred_semi = state.semi[state.eval(number[pred], i + 1)];
+            if (pred_semi < state.semi[i])
+                state.semi[i] = pred_semi;
+        }
+    }
+
+    for (size_t i = 1; i < size; i++) {
+        size_t candidate = state.idom[i];
+        while (candidate > state.semi[i])
+            candidate = state.idom[candidate];
+
+        state.idom[i] = candidate;
+    }
+
+    result.idom.assign(successors.node_count(), INVALID_NODE);
+    for (size_t i = 0; i < size; i++)
+        result.idom[result.order[i]] = result.order[state.idom[i]];
+
+    compute_dominator_depths(&result);
+
+    count_visited(size, edges_visited);
+
+    return result;
+}
+
+ImmediateDominators graphs::compute_immediate_dominators_by_levels(const Adjacency& predecessors,
+                                                                   const TopologicalLevels& levels,
+                                                                   NodeId root,
+                                                                   bool reversed_levels,
+                                                                   size_t thread_count,
+                                                                   size_t* nca_steps) {
+    assert(root < predecessors.node_count());
+    assert(thread_count > 0);
+
+    ImmediateDominators result;
+    result.idom.assign(predecessors.node_count(), INVALID_NODE);
+    result.depth.assign(predecessors.node_count(), INVALID_NODE);
+    result.jump.assign(predecessors.node_count(), INVALID_NODE);
+
+    result.idom[root]  = root;
+    result.depth[root] = 0;
+    result.jump[root]  = root;
+
+    size_t edges_visited = 0;
+    size_t steps = 0;
+
+    // Started at the first wide level
+    std::optional<LevelThreads> threads;
+
+    for (size_t i = 0; i < levels.level_count(); i++) {
+        std::span<const NodeId> level = levels.level(reversed_levels ? levels.level_count() - 1 - i : i);
+
+        if (thread_count > 1 && level.size() >= PARALLEL_LEVEL_MIN_WIDTH) {
+            if (!threads)
+                threads.emplace(thread_count);
+
+            edges_visited += process_level_parallel(predecessors, level, root, &result, &steps, &*threads);
+        } else {
+            edges_visited += process_level(predecessors, level, root, &result, &steps);
+        }
+    }
+
+    if (nca_steps)
+        *nca_steps += steps;
+
+    compute_dominator_order(&result);
+
+    count_visited(levels.order.size(), edges_visited);
+
+    return result;
+}
+
+void graphs::compute_dominator_depths(ImmediateDominators* doms) {
+    assert(doms);
+
+    doms->depth.assign(doms->idom.size(), INVALID_NODE);
+    doms->jump.assign(doms->idom.size(), INVALID_NODE);
+    if (doms->order.empty())
+        return;
+
+    doms->depth[doms->order.front()] = 0;
+    doms->jump[doms->order.front()]  = doms->order.front();
+
+    for (size_t i = 1; i < doms->order.size(); i++) {
+        NodeId node = doms->order[i];
+        doms->depth[node] = doms->depth[doms->idom[node]] + 1;
+        doms->jump[node]  = jump_target(*doms, doms->idom[node]);
+    }
+}
+
+void graphs::compute_dominator_order(ImmediateDominators* doms) {
+    assert(doms);
+    assert(doms->depth.size() == doms->idom.size());
+
+    // Counting sort by depth
+    std::vector<size_t> level_offsets;
+    for (size_t depth: doms->depth) {
+        if (depth == INVALID_NODE)
+            continue;
+
+        if (depth + 2 > level_offsets.size())
+            level_offsets.resize(depth + 2, 0);
+        level_offsets[depth + 1]++;
+    }
+
+    for (size_t i = 1; i < level_offsets.size(); i++)
+        level_offsets[i] += level_offsets[i - 1];
+
+    doms->order.assign(level_offsets.empty() ? 0 : level_offsets.back(), INVALID_NODE);
+    for (NodeId node = 0; node < doms->depth.size(); node++) {
+        if (doms->depth[node] != INVALID_NODE)
+            doms->order[level_offsets[doms->depth[node]]++] = node;
+    }
+}
+
+void graphs::update_immediate_dominators(const Adjacency& predecessors,
+                                         std::span<const NodeId> affected,
+                                         ImmediateDominators* doms,
+                                         size_t* nca_steps) {
+    assert(doms);
+    assert(doms->idom.size() == predecessors.node_count());
+    assert(doms->depth.size() == predecessors.node_count());
+    assert(doms->jump.size() == predecessors.node_count());
+
+    doms->order.clear();
+
+    size_t edges_visited = 0;
+    size_t steps = 0;
+
+    for (NodeId node: affected) {
+        if (doms->idom[node] == node) //< root
+            continue;
+
+        set_idom_from_predecessors(predecessors, node, doms, &steps);
+        edges_visited += predecessors[node].size();
+    }
+
+    if (nca_steps)
+        *nca_steps += steps;
+
+    count_visited(affected.size(), edges_visited);
+}
+
+Adjacency graphs::compute_dominance_frontiers(const Adjacency& predecessors,
+                                              const ImmediateDominators& doms) {
+    assert(doms.idom.size() == predecessors.node_count());
+
+    const size_t node_count = predecessors.node_count();
+
+    std::vector<Adjacency::Edge> frontier_edges;
+    std::vector<NodeId> last_join(node_count, INVALID_NODE); //< skips duplicates from shared chains
+
+    size_t edges_visited = 0;
+
+    for (NodeId join = 0; join < node_count; join++) {
+        std::span<const NodeId> preds = predecessors[join];
+        if (preds.size() < 2 || doms.idom[join] == INVALID_NODE)
+            continue;
+
+        edges_visited += preds.size();
+
+        for (NodeId runner: preds) {
+            if (doms.idom[runner] == INVALID_NODE)
+                continue;
+
+            while (runner != doms.idom[join] && last_join[runner] != join) {
+                last_join[runner] = join;
+                frontier_edges.emplace_back(runner, join);
+                runner = doms.idom[runner];
+            }
+        }
+    }
+
+    count_visited(node_count, edges_visited);
+
+    return Adjacency(node_count, frontier_edges);
+}
+
+std::vector<NodeId> graphs::compute_iterated_dominance_frontier(const Adjacency& frontiers,
+                                                                std::span<const NodeId> nodes) {
+    std::vector<bool> in_frontier(frontiers.node_count(), false);
+    std::vector<bool> processed(frontiers.node_count(), false);
+
+    std::vector<NodeId> result;
+    std::vector<NodeId> worklist(nodes.begin(), nodes.end());
+
+    while (!worklist.empty()) {
+        NodeId node = worklist.back();
+        worklist.pop_back();
+
+        if (processed[node])
+            continue;
+        processed[node] = true;
+
+        for (NodeId frontier_node: frontiers[node]) {
+            if (in_frontier[frontier_node])
+                continue;
+
+            in_frontier[frontier_node] = true;
+            result.push_back(frontier_node);
+            worklist.push_back(frontier_node);
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
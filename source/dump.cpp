@@ -1,58 +1,124 @@
 #include "dump.h"
-
+#include "graph_traversal.h"
+#include "image_renderer.h"
+#include "stats.h"
+
+#include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <string>
+#include <utility>
 
 using namespace graphs;
 
-void DumpableNode::dump_subtree(std::ofstream& file, DumpableNode* parent, size_t traversal_counter) {
-    if (parent != nullptr)
-        file << "node_" << parent->index_ << "->node_" << index_ << "[color=white]\n";
+void DotWriter::node(NodeIdx index, bool truncated) {
+    buffer_.append("\nnode_");
+    append_index_(index);
+    buffer_.append(" [label=\"");
+    append_label_(index);
+    buffer_.append(truncated ? "\", style=\"filled,dashed\"]\n" : "\"]\n");
+    nodes_written_++;
+    flush_if_full_();
+}
 
-    if (traversal_status_(traversal_counter) != UNVISITED) {
-        assert(traversal_status_(traversal_counter) == VISITED);
-        return;
+void DotWriter::chain(NodeIdx first, NodeIdx last, size_t length) {
+    buffer_.append("\nnode_");
+    append_index_(first);
+    buffer_.append(" [label=\"");
+    append_label_(first);
+    buffer_.append(" .. ");
+    append_label_(last);
+    buffer_.append("\\n");
+    append_index_(static_cast<NodeIdx>(length));
+    buffer_.append(" nodes\", style=\"filled,rounded\"]\n");
+    nodes_written_ += length;
+    flush_if_full_();
+}
+
+void DotWriter::edge(NodeIdx parent, NodeIdx child) {
+    buffer_.append("node_");
+    append_index_(parent);
+    buffer_.append("->node_");
+    append_index_(child);
+    buffer_.append("[color=white]\n");
+    edges_written_++;
+    flush_if_full_();
+}
+
+void DotWriter::flush() {
+    file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+void DotWriter::append_index_(NodeIdx index) {
+    char number[24];
+    auto [end, error] = std::to_chars(number, number + sizeof(number), index);
+    buffer_.append(number, end);
+}
+
+void DotWriter::append_label_(NodeIdx index) {
+    if (index == DumpableNode::START) {
+        buffer_.append("Start");
+    } else if (index == DumpableNode::END) {
+        buffer_.append("End");
+    } else {
+        buffer_.append("Node");
+        append_index_(index);
     }
-    traversal_counter_ = traversal_counter + VISITED;
+}
 
-    file << "\nnode_" << index_ << " [label=\"";
+void DumpableGraph::dump(std::filesystem::path path, ImageRenderer* renderer) const {
+    dump_(std::move(path), renderer, [this](DotWriter& writer, TraversalState& state) {
+        dump_traversal_entry_(writer, state);
+    });
+}
 
-    if (index_ == START)
-        file << "Start";
-    else if (index_ == END)
-        file << "End";
-    else
-        file << "Node" << index_;
+void DumpableGraph::dump_(std::filesystem::path path, ImageRenderer* renderer,
+                          const std::function<void(DotWriter&, TraversalState&)>& write_body) const {
+    {
+        PhaseTimer timer("dump_write");
 
-    file << "\"]\n";
+        std::ofstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        file.open(path.replace_extension("dot"), std::ios::binary);
 
-    dump_subtree_traversal_(file, traversal_counter);
+        // One buffer per thread keeps concurrent dumps apart and is reused by the thread's next dump
+        thread_local std::string buffer;
+        DotWriter writer(file, &buffer);
 
-    file << "\n";
-};
+        writer.text("digraph List{\n"
+                    "    graph [bgcolor=\"#1f1f1f\"];\n"
+                    "    node[shape=rect, color=white, fontcolor=\"#000000\", fontsize=14, "
+                        "fontname=\"verdana\", style=\"filled\", fillcolor=\"#6e7681\"];\n\n");
 
-void DumpableGraph::dump(std::filesystem::path path) {
-    std::ofstream file;
-    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    file.open(path.replace_extension("dot"));
+        TraversalState state;
+        write_body(writer, state);
 
-    file << "digraph List{\n"
-            "    graph [bgcolor=\"#1f1f1f\"];\n"
-            "    node[shape=rect, color=white, fontcolor=\"#000000\", fontsize=14, "
-                "fontname=\"verdana\", style=\"filled\", fillcolor=\"#6e7681\"];\n\n";
+        writer.text("\n}\n");
+        writer.flush();
 
-    dump_traversal_entry_(file);
-    traversal_counter_ += DumpableNode::VISITED;
+        timer.add_nodes(writer.nodes_written());
+        timer.add_edges(writer.edges_written());
 
-    file << "\n}\n";
+        file.close();
+    }
 
-    file.close();
+    if (!generate_dot_images_)
+        return;
 
-    if (generate_dot_images_)
+    if (renderer)
+        renderer->render(path);
+    else
         generate_dot_image(path);
 }
 
 void DumpableGraph::generate_dot_image(std::filesystem::path dot_path) {
+    PhaseTimer timer("dot_render");
+
     namespace fs = std::filesystem;
 
     fs::path image_path = dot_path;
@@ -0,0 +1,212 @@
+#include "generator.h"
+#include "dump.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace graphs;
+
+namespace {
+
+constexpr std::array<std::pair<GraphShape, std::string_view>, 5> SHAPE_NAMES = {{
+    {GraphShape::CHAIN,          "chain"},
+    {GraphShape::WIDE_FAN_OUT,   "wide_fan_out"},
+    {GraphShape::DIAMOND_LADDER, "diamond_ladder"},
+    {GraphShape::RANDOM_SPARSE,  "random_sparse"},
+    {GraphShape::CFG_LIKE,       "cfg_like"},
+}};
+
+constexpr size_t MAX_LOOP_LENGTH = 8;
+
+} // namespace
+
+std::string_view graphs::graph_shape_name(GraphShape shape) {
+    for (auto [known_shape, name]: SHAPE_NAMES) {
+        if (known_shape == shape)
+            return name;
+    }
+
+    assert(0 && "Unknown graph shape");
+    return "";
+}
+
+std::optional<GraphShape> graphs::parse_graph_shape(std::string_view name) {
+    for (auto [shape, known_name]: SHAPE_NAMES) {
+        if (known_name == name)
+            return shape;
+    }
+
+    return std::nullopt;
+}
+
+// Nodes are numbered 1..node_count and every generated edge goes forward, so a node's parents
+// are emitted before it. Loop edges go back along the first parents
+void GraphGenerator::generate(const LineSink& add_line) const {
+    const size_t node_count = options_.node_count;
+    std::mt19937_64 random_generator(options_.seed);
+
+    std::vector<NodeIdx> labels;
+    if (options_.shuffle_indexes) {
+        labels.resize(node_count);
+        std::iota(labels.begin(), labels.end(), 1);
+        std::shuffle(labels.begin(), labels.end(), random_generator);
+    }
+
+    auto label = [&labels](size_t node) {
+        return labels.empty() ? static_cast<NodeIdx>(node) : labels[node - 1];
+    };
+
+    std::vector<bool> is_loop_carrier(node_count + 1, false);
+    for (size_t placed = 0; placed < std::min(options_.loop_count, node_count);) {
+        size_t node = 1 + random_generator() % node_count;
+        if (!is_loop_carrier[node]) {
+            is_loop_carrier[node] = true;
+            placed++;
+        }
+    }
+
+    constexpr size_t NO_PARENT = 0;
+    std::vector<size_t> first_parent(node_count + 1, NO_PARENT);
+
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+    const double branch_probability = std::clamp(options_.density - 1.0, 0.0, 1.0);
+
+    std::vector<size_t> children;
+    std::vector<NodeIdx> line;
+
+    for (size_t node = 1; node <= node_count; node++) {
+        children.clear();
+
+        switch (options_.shape) {
+            case GraphShape::CHAIN:
+                if (node < node_count)
+                    children.push_back(node + 1);
+                break;
+
+            case GraphShape::WIDE_FAN_OUT:
+                for (size_t child = 2; node == 1 && child <= node_count; child++)
+                    children.push_back(child);
+                break;
+
+            case GraphShape::DIAMOND_LADDER: {
+                // Top t has children t + 1 and t + 2, both lead to the next top t + 3
+                const size_t offset = (node - 1) % 3;
+
+                if (offset == 0) {
+                    for (size_t child: {node + 1, node + 2}) {
+                        if (child <= node_count)
+                            children.push_back(child);
+                    }
+                } else if (node - offset + 3 <= node_count) {
+                    children.push_back(node - offset + 3);
+                }
+                break;
+            }
+
+            case GraphShape::RANDOM_SPARSE: {
+                if (node == node_count)
+                    break;
+
+                std::uniform_int_distribution<size_t> random_child(node + 1, node_count);
+
+                const double whole = std::floor(options_.density);
+                size_t child_count = static_cast<size_t>(whole) +
+                                     (probability(random_generator) < options_.density - whole);
+
+                while (child_count-- > 0)
+                    children.push_back(random_child(random_generator));
+                break;
+            }
+
+            case GraphShape::CFG_LIKE: {
+                if (node == node_count)
+                    break;
+
+                children.push_back(node + 1);
+                if (probability(random_generator) >= branch_probability)
+                    break;
+
+                size_t target = (random_generator() % 16 == 0)
+                                    ? node_count
+                                    : std::min(node_count, node + 2 + random_generator() % 8);
+
+                if (target != node + 1)
+                    children.push_back(target);
+                break;
+            }
+
+            default:
+                assert(0 && "Unknown graph shape");
+                break;
+        }
+
+        for (size_t child: children) {
+            if (first_parent[child] == NO_PARENT)
+                first_parent[child] = node;
+        }
+
+        if (is_loop_carrier[node]) {
+            size_t target = node;
+            for (size_t steps = 1 + random_generator() % MAX_LOOP_LENGTH;
+                 steps > 0 && first_parent[target] != NO_PARENT; steps--)
+                target = first_parent[target];
+
+            children.push_back(target);
+        }
+
+        // Nodes without children are mentioned by their parents
+        if (children.empty() && first_parent[node] != NO_PARENT)
+            continue;
+
+        line.clear();
+        line.push_back(label(node));
+        for (size_t child: children)
+            line.push_back(label(child));
+
+        add_line(line);
+    }
+}
+
+size_t GraphGenerator::write_text(std::ostream& stream) const {
+    constexpr size_t FLUSH_SIZE = 1 << 16;
+
+    std::string buffer;
+    buffer.reserve(FLUSH_SIZE + 1024);
+
+    size_t edge_count = 0;
+
+    generate([&](std::span<const NodeIdx> line) {
+        for (size_t i = 0; i < line.size(); i++) {
+            if (i != 0)
+                buffer += ' ';
+
+            char number[24];
+            auto [end, error] = std::to_chars(number, number + sizeof(number), line[i]);
+            buffer.append(number, end);
+        }
+        buffer += '\n';
+
+        edge_count += line.size() - 1;
+
+        if (buffer.size() >= FLUSH_SIZE) {
+            stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    });
+
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+    return edge_count;
+}
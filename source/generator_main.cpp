@@ -0,0 +1,79 @@
+#include "dagraph.h"
+#include "generator.h"
+
+#include <cxxopts.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace graphs;
+
+int main(int argc, const char* argv[]) {
+    cxxopts::Options options("graphs-gen",
+        "Synthetic Directed Acyclic Graph generator");
+
+    options.add_options()
+        ("o,output", "Output file", cxxopts::value<std::filesystem::path>())
+        ("n,nodes", "Node count", cxxopts::value<size_t>()->default_value("1000"))
+        ("t,shape", "chain, wide_fan_out, diamond_ladder, random_sparse or cfg_like",
+                    cxxopts::value<std::string>()->default_value("random_sparse"))
+        ("density", "Average children per node for random_sparse, 1 + branch probability for cfg_like",
+                    cxxopts::value<double>()->default_value("2"))
+        ("seed", "Random seed", cxxopts::value<uint64_t>()->default_value("0"))
+        ("loops", "Planted loop count", cxxopts::value<size_t>()->default_value("0"))
+        ("shuffle", "Shuffle node indexes")
+        ("b,binary", "Write binary snapshot instead of text")
+        ("h,help", "Print help")
+    ;
+
+    options.positional_help("<output>");
+
+    options.parse_positional("output");
+    options.show_positional_help();
+    auto opt_result = options.parse(argc, argv);
+
+    if (opt_result.count("help") || !opt_result.count("output")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::optional<GraphShape> shape = parse_graph_shape(opt_result["shape"].as<std::string>());
+    if (!shape.has_value()) {
+        std::cerr << "Unknown graph shape " << opt_result["shape"].as<std::string>() << std::endl;
+        return -1;
+    }
+
+    GraphGenerator generator({
+        .shape = *shape,
+        .node_count = opt_result["nodes"].as<size_t>(),
+        .density = opt_result["density"].as<double>(),
+        .seed = opt_result["seed"].as<uint64_t>(),
+        .loop_count = opt_result["loops"].as<size_t>(),
+        .shuffle_indexes = opt_result.count("shuffle") != 0,
+    });
+
+    const auto& output = opt_result["output"].as<std::filesystem::path>();
+
+    try {
+        if (opt_result.count("binary")) {
+            DAGraph(generator, false).save_snapshot(output);
+        } else {
+            std::ofstream file;
+            file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+            file.open(output);
+
+            generator.write_text(file);
+        }
+    } catch (const std::ios_base::failure& e) {
+        std::cerr << "Write error: " << e.what() << std::endl;
+        return -1;
+    } catch (DAGraph::loops_detected& e) {
+        std::cerr << "Snapshots can't contain loops, detected " << e.what() << " loop(s)" << std::endl;
+        return -3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "image_renderer.h"
+#include "dump.h"
+
+#include <cassert>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <utility>
+
+using namespace graphs;
+
+ImageRenderer::ImageRenderer(size_t thread_count) {
+    assert(thread_count > 0);
+
+    for (size_t i = 0; i < thread_count; i++)
+        workers_.emplace_back([this]() { work_(); });
+}
+
+ImageRenderer::~ImageRenderer() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    queue_changed_.notify_all();
+}
+
+void ImageRenderer::render(std::filesystem::path dot_path) {
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back(std::move(dot_path));
+    }
+    queue_changed_.notify_one();
+}
+
+void ImageRenderer::wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this]() { return queue_.empty() && busy_workers_ == 0; });
+}
+
+void ImageRenderer::work_() {
+    std::unique_lock lock(mutex_);
+
+    while (true) {
+        queue_changed_.wait(lock, [this]() { return !queue_.empty() || stopping_; });
+
+        if (queue_.empty())
+            return;
+
+        std::filesystem::path dot_path = std::move(queue_.front());
+        queue_.pop_front();
+        busy_workers_++;
+
+        lock.unlock();
+        DumpableGraph::generate_dot_image(dot_path);
+        lock.lock();
+
+        busy_workers_--;
+        if (queue_.empty() && busy_workers_ == 0)
+            idle_.notify_all();
+    }
+}
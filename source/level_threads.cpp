@@ -0,0 +1,41 @@
+#include "level_threads.h"
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+
+using namespace graphs;
+
+LevelThreads::LevelThreads(size_t thread_count) : barrier_(static_cast<ptrdiff_t>(thread_count)) {
+    assert(thread_count > 0);
+
+    for (size_t thread = 1; thread < thread_count; thread++)
+        workers_.emplace_back([this, thread]() { work_(thread); });
+}
+
+LevelThreads::~LevelThreads() {
+    task_ = nullptr;
+    barrier_.arrive_and_wait();
+}
+
+void LevelThreads::run(const std::function<void(size_t)>& task) {
+    task_ = &task;
+    barrier_.arrive_and_wait();
+
+    task(0);
+
+    barrier_.arrive_and_wait();
+    task_ = nullptr;
+}
+
+void LevelThreads::work_(size_t thread) {
+    while (true) {
+        barrier_.arrive_and_wait();
+        if (!task_)
+            return;
+
+        (*task_)(thread);
+
+        barrier_.arrive_and_wait();
+    }
+}
@@ -1,12 +1,19 @@
 #include "dagraph.h"
 #include "dom_tree.h"
+#include "image_renderer.h"
+#include "mapped_file.h"
+#include "memory_usage.h"
+#include "stats.h"
 
+#include <algorithm>
 #include <cxxopts.hpp>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace graphs;
 
@@ -15,9 +22,24 @@ int main(int argc, const char* argv[]) {
         "Directed Acyclic Graph topological sorting and dominator tree building");
 
     options.add_options()
-        ("i,input", "Input file with graph description", cxxopts::value<std::filesystem::path>())
+        ("i,input", "Input file with graph description or snapshot", cxxopts::value<std::filesystem::path>())
         ("d,dump_dir", "Dump directory", cxxopts::value<std::filesystem::path>()->
                                                   default_value("dumps/"))
+        ("j,jobs", "Parsing and sorting threads, 0 - all hardware threads", cxxopts::value<size_t>()->
+                                                  default_value("1"))
+        ("r,render_jobs", "Background svg rendering threads, 0 - render while dumping", cxxopts::value<size_t>()->
+                                                  default_value("1"))
+        ("focus", "Dump only the neighborhood of these node indexes", cxxopts::value<std::vector<NodeIdx>>())
+        ("radius", "Neighborhood radius of --focus dumps", cxxopts::value<size_t>()->default_value("2"))
+        ("collapse", "Dump linear chains of nodes as single boxes")
+        ("depth", "Dominator tree dump depth, 0 - whole trees", cxxopts::value<size_t>()->default_value("0"))
+        ("dom_algorithm", "Dominator tree algorithm: semi_nca or levels, levels use --jobs threads",
+                                                  cxxopts::value<std::string>()->default_value("semi_nca"))
+        ("condense", "Condense loops into single nodes instead of rejecting the graph")
+        ("relabel", "Renumber parsed nodes in reverse postorder for memory locality")
+        ("s,snapshot", "Save binary graph snapshot with analysis results", cxxopts::value<std::filesystem::path>())
+        ("m,memory", "Print peak resident set size")
+        ("stats", "Print per phase statistics as JSON, needs GRAPHS_ENABLE_STATS build")
         ("h,help", "Print help")
     ;
 
@@ -32,28 +54,97 @@ int main(int argc, const char* argv[]) {
         return 0;
     }
 
+    const std::string dom_algorithm_name = opt_result["dom_algorithm"].as<std::string>();
+    if (dom_algorithm_name != "semi_nca" && dom_algorithm_name != "levels") {
+        std::cerr << "Unknown dominator tree algorithm " << dom_algorithm_name << std::endl;
+        return -4;
+    }
+
+    const auto dom_algorithm = dom_algorithm_name == "levels" ? DAGraph::DomAlgorithm::LEVELS
+                                                              : DAGraph::DomAlgorithm::SEMI_NCA;
+
     const auto& dump_dir = opt_result["dump_dir"].as<std::filesystem::path>();
     std::filesystem::create_directory(dump_dir);
 
     try {
-        std::ifstream file;
-        file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-        file.open(opt_result["input"].as<std::filesystem::path>());
+        MappedFile input(opt_result["input"].as<std::filesystem::path>());
+
+        size_t jobs = opt_result["jobs"].as<size_t>();
+        if (jobs == 0)
+            jobs = std::max(std::thread::hardware_concurrency(), 1u);
+
+        std::unique_ptr<ImageRenderer> renderer;
+        if (size_t render_jobs = opt_result["render_jobs"].as<size_t>())
+            renderer = std::make_unique<ImageRenderer>(render_jobs);
+
+        const bool focus    = opt_result.count("focus");
+        const bool collapse = opt_result.count("collapse");
+        const size_t depth  = opt_result["depth"].as<size_t>();
+
+        // Full input is dumped before loops are checked, size-aware dumps need the parsed graph
+        const bool full_input_dump = !DAGraph::is_snapshot(input) && !focus && !collapse;
+        const auto loop_policy = opt_result.count("condense") ? DAGraph::LoopPolicy::CONDENSE
+                                                              : DAGraph::LoopPolicy::REJECT;
+
+        DAGraph graph = DAGraph::is_snapshot(input)
+                            ? DAGraph::from_snapshot(input)
+                            : DAGraph(input, full_input_dump ? dump_dir / "input" : std::filesystem::path(),
+                                      true, jobs, loop_policy, renderer.get());
+
+        if (opt_result.count("relabel") && !DAGraph::is_snapshot(input))
+            graph.relabel_nodes();
 
-        std::stringstream file_contents;
-        file_contents << file.rdbuf();
-        file.close();
+        std::vector<NodeId> focus_nodes;
+        if (focus) {
+            for (NodeIdx index: opt_result["focus"].as<std::vector<NodeIdx>>()) {
+                NodeId node = graph.find_node(index);
+                if (node == INVALID_NODE)
+                    throw DAGraph::creation_error("no focus node " + std::to_string(index));
 
-        DAGraph graph(file_contents, dump_dir / "input");
+                focus_nodes.push_back(node);
+            }
+        }
 
-        graph.topological_sort();
-        graph.dump(dump_dir / "topo_sort");
+        auto dump_graph = [&](const std::string& name) {
+            if (focus)
+                graph.dump_neighborhood(dump_dir / name, focus_nodes, opt_result["radius"].as<size_t>(),
+                                        renderer.get());
+            else if (collapse)
+                graph.dump_collapsed(dump_dir / name, renderer.get());
+            else
+                graph.dump(dump_dir / name, renderer.get());
+        };
 
-        DomTree dominator_tree = graph.build_dominator_tree();
-        dominator_tree.dump(dump_dir / "dom_tree");
+        auto dump_tree = [&](DomTree& tree, const std::string& name, NodeIdx root) {
+            if (depth != 0)
+                tree.dump_subtree(dump_dir / name, root, depth, renderer.get());
+            else
+                tree.dump(dump_dir / name, renderer.get());
+        };
 
-        DomTree postdominator_tree = graph.build_postdominator_tree();
-        postdominator_tree.dump(dump_dir / "postdom_tree");
+        if (!full_input_dump)
+            dump_graph("input");
+
+        graph.topological_sort(DAGraph::TopoSortAlgorithm::KAHN, jobs);
+        dump_graph("topo_sort");
+
+        DomTree dominator_tree = graph.build_dominator_tree(dom_algorithm, jobs);
+        dump_tree(dominator_tree, "dom_tree", DumpableNode::START);
+
+        DomTree postdominator_tree = graph.build_postdominator_tree(dom_algorithm, jobs);
+        dump_tree(postdominator_tree, "postdom_tree", DumpableNode::END);
+
+        if (opt_result.count("snapshot"))
+            graph.save_snapshot(opt_result["snapshot"].as<std::filesystem::path>());
+
+        if (renderer)
+            renderer->wait();
+
+        if (opt_result.count("memory"))
+            std::cout << "Peak RSS: " << peak_rss_bytes() / 1024 << " KiB" << std::endl;
+
+        if (opt_result.count("stats"))
+            write_stats_json(std::cout);
 
     } catch (const std::ifstream::failure &e) {
         std::cerr << "DAGraph read error: " << e.what() << std::endl;
@@ -63,6 +154,15 @@ int main(int argc, const char* argv[]) {
         return -2;
     }  catch (DAGraph::loops_detected& e) {
         std::cerr << "Detected " << e.what() << " loop(s) in graph" << std::endl;
+
+        constexpr size_t MAX_PRINTED_CYCLES = 10;
+        for (size_t i = 0; i < std::min(e.cycles.size(), MAX_PRINTED_CYCLES); i++) {
+            std::cerr << "   ";
+            for (NodeIdx index: e.cycles[i])
+                std::cerr << " " << index;
+            std::cerr << std::endl;
+        }
+
         return -3;
     }
 
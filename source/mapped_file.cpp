@@ -0,0 +1,58 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <filesystem>
+#include <ios>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace graphs;
+
+namespace {
+
+// error is the errno of the failed call, close() may overwrite errno before the throw
+[[noreturn]] void throw_io_error(const std::string& what, const std::filesystem::path& path, int error) {
+    throw std::ios_base::failure(what + " " + path.string(),
+                                 std::error_code(error, std::generic_category()));
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw_io_error("can't open", path, errno);
+
+    struct stat file_stat = {};
+    if (fstat(fd, &file_stat) != 0) {
+        const int error = errno;
+        close(fd);
+        throw_io_error("can't stat", path, error);
+    }
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+
+    if (size_ != 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw_io_error("can't map", path, error);
+        }
+
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr)
+        munmap(const_cast<char*>(data_), size_);
+}
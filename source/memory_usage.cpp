@@ -0,0 +1,19 @@
+#include "memory_usage.h"
+
+#include <cstddef>
+#include <sys/resource.h>
+
+using namespace graphs;
+
+size_t graphs::peak_rss_bytes() {
+    rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    // Linux reports kilobytes, macOS reports bytes
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
@@ -0,0 +1,310 @@
+#include "adjacency.h"
+#include "dagraph.h"
+#include "dominators.h"
+#include "mapped_file.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace graphs;
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'D', 'A', 'G', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 3;
+
+// Followed by arrays in native byte order:
+//   node indexes [node_count], edge offsets [node_count + 1], edge targets [edge_count],
+//   predecessor offsets [node_count + 1] and sources [edge_count],
+//   topological order [topological_order_size],
+//   dominator tree order [dominators_size] and idoms [node_count] if dominators_size != 0,
+//   postdominator tree order and idoms the same way,
+//   condensed node ids [condensed_count], their offsets [condensed_count + 1]
+//   and original indexes [last offset]
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t node_idx_size;
+    uint32_t node_id_size;
+    uint32_t offset_size;
+
+    uint64_t node_count;
+    uint64_t edge_count;
+    uint64_t topological_order_size;
+    uint64_t dominators_size;
+    uint64_t postdominators_size;
+    uint64_t condensed_count;
+};
+
+template <class T>
+void write_array(std::ofstream& file, std::span<const T> array) {
+    file.write(reinterpret_cast<const char*>(array.data()),
+               static_cast<std::streamsize>(array.size_bytes()));
+}
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::string_view data) : data_(data) {}
+
+    template <class T>
+    std::vector<T> read_array(size_t count) {
+        if (count > data_.size() / sizeof(T))
+            throw DAGraph::creation_error("snapshot is truncated");
+
+        std::vector<T> array(count);
+        std::memcpy(array.data(), data_.data(), count * sizeof(T));
+        data_.remove_prefix(count * sizeof(T));
+
+        return array;
+    }
+
+    SnapshotHeader read_header() {
+        if (data_.size() < sizeof(SnapshotHeader))
+            throw DAGraph::creation_error("snapshot is truncated");
+
+        SnapshotHeader header = {};
+        std::memcpy(&header, data_.data(), sizeof(header));
+        data_.remove_prefix(sizeof(header));
+
+        return header;
+    }
+
+private:
+    std::string_view data_;
+};
+
+void check_node_ids(std::span<const NodeId> ids, size_t node_count, bool allow_invalid = false) {
+    for (NodeId id: ids) {
+        if (id >= node_count && !(allow_invalid && id == INVALID_NODE))
+            throw DAGraph::creation_error(std::format("snapshot contains invalid node id {}", id));
+    }
+}
+
+void check_topological_order(std::span<const NodeId> order, size_t node_count) {
+    if (order.empty())
+        return;
+
+    std::vector<char> seen(node_count, false);
+    for (NodeId node: order) {
+        if (seen[node])
+            throw DAGraph::creation_error("snapshot contains corrupted topological order");
+        seen[node] = true;
+    }
+
+    if (order.size() != node_count)
+        throw DAGraph::creation_error("snapshot contains corrupted topological order");
+}
+
+// Every node in the order is preceded by its idom, nodes out of the order have no idom
+void check_dominator_tree(const ImmediateDominators& doms, NodeId root) {
+    if (doms.order.front() != root || doms.idom[root] != root)
+        throw DAGraph::creation_error("snapshot contains corrupted dominator tree");
+
+    std::vector<char> seen(doms.idom.size(), false);
+    seen[root] = true;
+
+    for (size_t i = 1; i < doms.order.size(); i++) {
+        NodeId node = doms.order[i];
+        NodeId idom = doms.idom[node];
+
+        if (seen[node] || idom == INVALID_NODE || !seen[idom])
+            throw DAGraph::creation_error("snapshot contains corrupted dominator tree");
+        seen[node] = true;
+    }
+
+    for (NodeId node = 0; node < doms.idom.size(); node++) {
+        if (!seen[node] && doms.idom[node] != INVALID_NODE)
+            throw DAGraph::creation_error("snapshot contains corrupted dominator tree");
+    }
+}
+
+Adjacency read_adjacency(SnapshotReader* reader, size_t node_count, size_t edge_count) {
+    assert(reader);
+
+    std::vector<size_t> offsets = reader->read_array<size_t>(node_count + 1);
+    std::vector<NodeId> targets = reader->read_array<NodeId>(edge_count);
+
+    if (offsets.front() != 0 || offsets.back() != targets.size() ||
+        !std::is_sorted(offsets.begin(), offsets.end()))
+        throw DAGraph::creation_error("snapshot contains corrupted edge offsets");
+
+    check_node_ids(targets, node_count);
+
+    return Adjacency(std::move(offsets), std::move(targets));
+}
+
+ImmediateDominators read_dominators(SnapshotReader* reader, size_t order_size, size_t node_count,
+                                    NodeId root) {
+    assert(reader);
+
+    ImmediateDominators doms;
+    if (order_size == 0)
+        return doms;
+
+    doms.order = reader->read_array<NodeId>(order_size);
+    doms.idom  = reader->read_array<NodeId>(node_count);
+
+    check_node_ids(doms.order, node_count);
+    check_node_ids(doms.idom, node_count, true);
+    check_dominator_tree(doms, root);
+
+    compute_dominator_depths(&doms);
+
+    return doms;
+}
+
+// Order is dropped by incremental updates and restored lazily
+ImmediateDominators with_dominator_order(const ImmediateDominators& doms) {
+    ImmediateDominators result = doms;
+    if (result.order.empty() && !result.idom.empty())
+        compute_dominator_order(&result);
+
+    return result;
+}
+
+} // namespace
+
+void DAGraph::save_snapshot(const std::filesystem::path& path) const {
+    PhaseTimer timer("save_snapshot");
+
+    std::ofstream file;
+    file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+    file.open(path, std::ios::binary);
+
+    Adjacency successors = successors_;
+    if (!successors.is_compact())
+        successors.compact();
+
+    Adjacency predecessors = predecessors_;
+    if (!predecessors.is_compact())
+        predecessors.compact();
+
+    const ImmediateDominators dominators     = with_dominator_order(dominators_);
+    const ImmediateDominators postdominators = with_dominator_order(postdominators_);
+
+    SnapshotHeader header = {
+        .magic = {},
+        .version = SNAPSHOT_VERSION,
+        .node_idx_size = sizeof(NodeIdx),
+        .node_id_size  = sizeof(NodeId),
+        .offset_size   = sizeof(size_t),
+        .node_count = node_count(),
+        .edge_count = successors.edge_count(),
+        .topological_order_size = topological_order_.size(),
+        .dominators_size        = dominators.order.size(),
+        .postdominators_size    = postdominators.order.size(),
+        .condensed_count        = condensed_indexes_.size(),
+    };
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    write_array(file, std::span<const NodeIdx>(indexes_));
+    write_array(file, successors.offsets());
+    write_array(file, successors.targets());
+    write_array(file, predecessors.offsets());
+    write_array(file, predecessors.targets());
+
+    timer.add_nodes(indexes_.size());
+    timer.add_edges(successors.targets().size());
+
+    write_array(file, std::span<const NodeId>(topological_order_));
+
+    for (const ImmediateDominators* doms: {&dominators, &postdominators}) {
+        if (doms->order.empty())
+            continue;
+
+        write_array(file, std::span<const NodeId>(doms->order));
+        write_array(file, std::span<const NodeId>(doms->idom));
+    }
+
+    std::vector<NodeId> condensed_nodes;
+    condensed_nodes.reserve(condensed_indexes_.size());
+    for (const auto& [node, node_indexes]: condensed_indexes_)
+        condensed_nodes.push_back(node);
+    std::ranges::sort(condensed_nodes);
+
+    std::vector<size_t> condensed_offsets = {0};
+    std::vector<NodeIdx> condensed_indexes;
+    for (NodeId node: condensed_nodes) {
+        const std::vector<NodeIdx>& node_indexes = condensed_indexes_.at(node);
+        condensed_indexes.insert(condensed_indexes.end(), node_indexes.begin(), node_indexes.end());
+        condensed_offsets.push_back(condensed_indexes.size());
+    }
+
+    write_array(file, std::span<const NodeId>(condensed_nodes));
+    write_array(file, std::span<const size_t>(condensed_offsets));
+    write_array(file, std::span<const NodeIdx>(condensed_indexes));
+}
+
+bool DAGraph::is_snapshot(const MappedFile& file) {
+    return file.view().starts_with(std::string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)));
+}
+
+DAGraph DAGraph::from_snapshot(const MappedFile& file, bool generate_dot_images) {
+    if (!is_snapshot(file))
+        throw creation_error("not a graph snapshot");
+
+    PhaseTimer timer("load_snapshot");
+
+    SnapshotReader reader(file.view());
+    SnapshotHeader header = reader.read_header();
+
+    if (header.version != SNAPSHOT_VERSION)
+        throw creation_error(std::format("unsupported snapshot version {}", header.version));
+
+    if (header.node_idx_size != sizeof(NodeIdx) || header.node_id_size != sizeof(NodeId) ||
+        header.offset_size != sizeof(size_t))
+        throw creation_error("snapshot was written with different index sizes");
+
+    if (header.node_count < END_ID + 1)
+        throw creation_error("snapshot has no Start and End nodes");
+
+    const size_t node_count = header.node_count;
+
+    DAGraph graph(EmptyGraphTag{}, generate_dot_images);
+
+    graph.indexes_ = reader.read_array<NodeIdx>(node_count);
+    graph.index_nodes_();
+
+    graph.successors_   = read_adjacency(&reader, node_count, header.edge_count);
+    graph.predecessors_ = read_adjacency(&reader, node_count, header.edge_count);
+
+    timer.add_nodes(node_count);
+    timer.add_edges(header.edge_count);
+
+    graph.topological_order_ = reader.read_array<NodeId>(header.topological_order_size);
+    check_node_ids(graph.topological_order_, node_count);
+    check_topological_order(graph.topological_order_, node_count);
+
+    graph.dominators_     = read_dominators(&reader, header.dominators_size, node_count, START_ID);
+    graph.postdominators_ = read_dominators(&reader, header.postdominators_size, node_count, END_ID);
+
+    std::vector<NodeId> condensed_nodes = reader.read_array<NodeId>(header.condensed_count);
+    check_node_ids(condensed_nodes, node_count);
+
+    std::vector<size_t> condensed_offsets = reader.read_array<size_t>(header.condensed_count + 1);
+    if (condensed_offsets.front() != 0 ||
+        !std::is_sorted(condensed_offsets.begin(), condensed_offsets.end()))
+        throw creation_error("snapshot contains corrupted condensed offsets");
+
+    std::vector<NodeIdx> condensed_indexes = reader.read_array<NodeIdx>(condensed_offsets.back());
+
+    for (size_t i = 0; i < condensed_nodes.size(); i++) {
+        graph.condensed_indexes_[condensed_nodes[i]].assign(
+            condensed_indexes.begin() + static_cast<ptrdiff_t>(condensed_offsets[i]),
+            condensed_indexes.begin() + static_cast<ptrdiff_t>(condensed_offsets[i + 1]));
+    }
+
+    return graph;
+}
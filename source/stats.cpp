@@ -0,0 +1,144 @@
+#include "stats.h"
+#include "memory_usage.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+using namespace graphs;
+
+namespace {
+
+std::mutex stats_mutex;
+std::map<std::string, PhaseStats, std::less<>> phases;
+
+#if defined(GRAPHS_ENABLE_STATS)
+thread_local size_t thread_allocations = 0;
+thread_local size_t thread_allocated_bytes = 0;
+
+thread_local PhaseTimer* current_timer = nullptr;
+#endif
+
+} // namespace
+
+#if defined(GRAPHS_ENABLE_STATS)
+
+// Counting replacements of the global allocation functions, array and nothrow forms forward to them.
+// Both sides use malloc and free, GCC can't see that through the replacement
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    thread_allocations++;
+    thread_allocated_bytes += size;
+
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    thread_allocations++;
+    thread_allocated_bytes += size;
+
+    const size_t align = static_cast<size_t>(alignment);
+    if (void* memory = std::aligned_alloc(align, (size + align - 1) / align * align))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+
+PhaseTimer::PhaseTimer(std::string_view phase)
+    : phase_(phase), start_(std::chrono::steady_clock::now()), outer_(current_timer) {
+    stats_.allocations     = thread_allocations;
+    stats_.allocated_bytes = thread_allocated_bytes;
+
+    current_timer = this;
+}
+
+PhaseTimer* PhaseTimer::current() {
+    return current_timer;
+}
+
+PhaseTimer::~PhaseTimer() {
+    current_timer = outer_;
+
+    stats_.calls = 1;
+    stats_.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    stats_.allocations     = thread_allocations - stats_.allocations;
+    stats_.allocated_bytes = thread_allocated_bytes - stats_.allocated_bytes;
+
+    std::lock_guard lock(stats_mutex);
+
+    auto phase = phases.find(phase_);
+    if (phase == phases.end())
+        phase = phases.emplace(phase_, PhaseStats()).first;
+
+    PhaseStats& total = phase->second;
+    total.calls           += stats_.calls;
+    total.wall_seconds    += stats_.wall_seconds;
+    total.nodes_visited   += stats_.nodes_visited;
+    total.edges_visited   += stats_.edges_visited;
+    total.allocations     += stats_.allocations;
+    total.allocated_bytes += stats_.allocated_bytes;
+}
+
+#endif
+
+std::map<std::string, PhaseStats> graphs::collected_stats() {
+    std::lock_guard lock(stats_mutex);
+
+    return {phases.begin(), phases.end()};
+}
+
+void graphs::reset_stats() {
+    std::lock_guard lock(stats_mutex);
+
+    phases.clear();
+}
+
+size_t graphs::calling_thread_allocated_bytes() {
+#if defined(GRAPHS_ENABLE_STATS)
+    return thread_allocated_bytes;
+#else
+    return 0;
+#endif
+}
+
+void graphs::write_stats_json(std::ostream& stream) {
+    stream << "{\n"
+           << "  \"enabled\": " << (STATS_ENABLED ? "true" : "false") << ",\n"
+           << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n"
+           << "  \"phases\": {";
+
+    bool first = true;
+    for (const auto& [name, phase]: collected_stats()) {
+        stream << (first ? "\n" : ",\n")
+               << "    \"" << name << "\": {"
+               << "\"calls\": " << phase.calls
+               << ", \"wall_seconds\": " << phase.wall_seconds
+               << ", \"nodes_visited\": " << phase.nodes_visited
+               << ", \"edges_visited\": " << phase.edges_visited
+               << ", \"allocations\": " << phase.allocations
+               << ", \"allocated_bytes\": " << phase.allocated_bytes << "}";
+        first = false;
+    }
+
+    stream << (first ? "}\n" : "\n  }\n") << "}\n";
+}
@@ -0,0 +1,126 @@
+#include "topological.h"
+#include "adjacency.h"
+#include "level_threads.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <vector>
+
+using namespace graphs;
+
+namespace {
+
+// Both return the number of edges visited
+size_t process_level(const Adjacency& successors, std::span<const NodeId> level,
+                     std::vector<size_t>* in_degrees, std::vector<NodeId>* next_level) {
+    assert(in_degrees && next_level);
+
+    size_t edges_visited = 0;
+
+    for (NodeId node: level) {
+        edges_visited += successors[node].size();
+
+        for (NodeId child: successors[node]) {
+            if (--(*in_degrees)[child] == 0)
+                next_level->push_back(child);
+        }
+    }
+
+    return edges_visited;
+}
+
+size_t process_level_parallel(const Adjacency& successors, std::span<const NodeId> level,
+                              std::vector<size_t>* in_degrees, std::vector<NodeId>* next_level,
+                              std::vector<std::vector<NodeId>>* thread_levels, LevelThreads* threads) {
+    assert(in_degrees && next_level && thread_levels && threads);
+    assert(thread_levels->size() == threads->thread_count());
+
+    const size_t thread_count = threads->thread_count();
+    const size_t part_size = (level.size() + thread_count - 1) / thread_count;
+
+    std::vector<size_t> edges_visited(thread_count, 0);
+
+    threads->run([&](size_t thread) {
+        std::vector<NodeId>& found = (*thread_levels)[thread];
+        found.clear();
+
+        size_t begin = std::min(thread * part_size, level.size());
+        size_t end   = std::min(begin + part_size, level.size());
+
+        for (NodeId node: level.subspan(begin, end - begin)) {
+            edges_visited[thread] += successors[node].size();
+
+            for (NodeId child: successors[node]) {
+                std::atomic_ref<size_t> in_degree((*in_degrees)[child]);
+
+                if (in_degree.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    found.push_back(child);
+            }
+        }
+    });
+
+    for (const auto& found: *thread_levels)
+        next_level->insert(next_level->end(), found.begin(), found.end());
+
+    return std::accumulate(edges_visited.begin(), edges_visited.end(), size_t(0));
+}
+
+} // namespace
+
+TopologicalLevels graphs::compute_topological_levels(const Adjacency& successors,
+                                                     const Adjacency& predecessors,
+                                                     size_t thread_count) {
+    assert(successors.node_count() == predecessors.node_count());
+    assert(thread_count > 0);
+
+    const size_t node_count = successors.node_count();
+
+    TopologicalLevels levels;
+    levels.order.reserve(node_count);
+
+    std::vector<size_t> in_degrees(node_count);
+    for (NodeId node = 0; node < node_count; node++) {
+        in_degrees[node] = predecessors[node].size();
+
+        if (in_degrees[node] == 0)
+            levels.order.push_back(node);
+    }
+
+    std::vector<std::vector<NodeId>> thread_levels(thread_count);
+    size_t edges_visited = 0;
+
+    // Started at the first wide level
+    std::optional<LevelThreads> threads;
+
+    // Every node is added to order once, so the reserved storage is never reallocated
+    // and the current level can be read while the next one is appended
+    while (levels.order.size() != levels.level_offsets.back()) {
+        std::span<const NodeId> level(levels.order.begin() + static_cast<ptrdiff_t>(levels.level_offsets.back()),
+                                      levels.order.end());
+        levels.level_offsets.push_back(levels.order.size());
+
+        if (thread_count > 1 && level.size() >= PARALLEL_LEVEL_MIN_WIDTH) {
+            if (!threads)
+                threads.emplace(thread_count);
+
+            edges_visited += process_level_parallel(successors, level, &in_degrees, &levels.order,
+                                                    &thread_levels, &*threads);
+        } else {
+            edges_visited += process_level(successors, level, &in_degrees, &levels.order);
+        }
+
+        assert(levels.order.size() <= node_count);
+        std::sort(levels.order.begin() + static_cast<ptrdiff_t>(levels.level_offsets.back()),
+                  levels.order.end());
+    }
+
+    count_visited(levels.order.size(), edges_visited);
+
+    return levels;
+}
@@ -1,12 +1,22 @@
 #include "dagraph.h"
+#include "image_renderer.h"
+#include "level_threads.h"
+#include "memory_usage.h"
+#include "stats.h"
 
 #include <algorithm>
+#include <bit>
 #include <cstddef>
 #include <filesystem>
 #include <format>
+#include <fstream>
+#include <limits>
+#include <map>
 #include <numeric>
+#include <optional>
 #include <random>
 #include <sstream>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include <vector>
@@ -17,12 +27,21 @@ using namespace graphs;
 
 std::stringstream build_random_dag_description(size_t n, bool add_loop);
 
+std::string build_chain_with_sink_description(size_t chain_length);
+
 std::filesystem::path get_test_dump_dir(const testing::TestInfo* const test_info);
 
 std::stringstream read_from_file(std::filesystem::path path);
 
+void check_dominance_queries(DomTree* dom_tree, NodeIdx root);
+
+void check_dominance_frontiers(DAGraph* graph, DomTree* dom_tree);
+
 #define DUMP_DIR (get_test_dump_dir(testing::UnitTest::GetInstance()->current_test_info()))
 
+// Nearest common dominator searches with jump pointers take O(log depth) steps
+constexpr size_t MAX_NCA_STEPS_PER_LOG_DEPTH = 4;
+
 std::stringstream build_random_dag_description(size_t n, bool add_loop = false) {
     std::vector<size_t> node_indexes(n);
     std::iota(node_indexes.begin(), node_indexes.end(), 1);
@@ -70,6 +89,20 @@ std::stringstream build_random_dag_description(size_t n, bool add_loop = false)
     return description;
 }
 
+// Chain 1 .. n where every node also leads to the sink n + 1, the sink's predecessors span the
+// whole depth of the dominator tree
+std::string build_chain_with_sink_description(size_t chain_length) {
+    const size_t sink = chain_length + 1;
+
+    std::string description;
+    for (size_t node = 1; node < chain_length; node++)
+        description += std::format("{} {} {}\n", node, node + 1, sink);
+
+    description += std::format("{} {}\n", chain_length, sink);
+
+    return description;
+}
+
 std::filesystem::path get_test_dump_dir(const testing::TestInfo* const test_info) {
     using namespace std::filesystem;
 
@@ -106,6 +139,268 @@ TEST(ExamplesTest, BasicExample) {
     });
 }
 
+TEST(ExamplesTest, MappedFileExample) {
+    MappedFile file(std::filesystem::path(TESTS_SRC_DIR) / "example_dominators.txt");
+    DAGraph mapped_graph(file);
+
+    std::stringstream stream = read_from_file("example_dominators.txt");
+    DAGraph stream_graph(stream);
+
+    EXPECT_TRUE(mapped_graph.build_dominator_tree() == stream_graph.build_dominator_tree());
+    EXPECT_TRUE(mapped_graph.build_postdominator_tree() == stream_graph.build_postdominator_tree());
+}
+
+TEST(ExamplesTest, MalformedInput) {
+    EXPECT_THROW({
+        DAGraph graph("1 2\n2 3x\n");
+    }, DAGraph::creation_error);
+
+    EXPECT_THROW({
+        DAGraph graph("1 2\n1 3\n");
+    }, DAGraph::creation_error);
+
+    EXPECT_NO_THROW({
+        DAGraph graph("1 2\r\n\n  \n2\t3\n");
+    });
+
+    // Indexes wider than NodeIdx of this build
+    EXPECT_THROW({
+        DAGraph graph("1 " + std::to_string(std::numeric_limits<NodeIdx>::max()) + "0\n");
+    }, DAGraph::creation_error);
+
+    // Start and End indexes
+    for (NodeIdx reserved: {NodeIdx(DumpableNode::START), NodeIdx(DumpableNode::END)}) {
+        try {
+            DAGraph graph("1 " + std::to_string(reserved) + "\n");
+            FAIL() << "Reserved index " << reserved << " is accepted";
+        } catch (const DAGraph::creation_error& e) {
+            EXPECT_EQ(e.what(), std::format("Node index {} is reserved for Start and End", reserved));
+        }
+    }
+}
+
+TEST(ExamplesTest, ParallelParsingErrors) {
+    std::stringstream input;
+    for (size_t i = 1; i < 1000; i++)
+        input << i << " " << i + 1 << '\n';
+
+    std::string text = input.str();
+
+    try {
+        DAGraph graph(text + "7 8\n1 x\n", {}, false, 4);
+        FAIL();
+    } catch (const DAGraph::creation_error& e) {
+        EXPECT_STREQ(e.what(), "Trying to add existing node 7");
+    }
+
+    try {
+        DAGraph graph(text + "1001 x\n1 2\n", {}, false, 4);
+        FAIL();
+    } catch (const DAGraph::creation_error& e) {
+        EXPECT_STREQ(e.what(), "failed to parse line 1000 \"1001 x\"");
+    }
+}
+
+TEST(ExamplesTest, SnapshotRoundTrip) {
+    std::stringstream file = read_from_file("example_dominators.txt");
+    DAGraph graph(file, {}, false);
+
+    graph.topological_sort();
+    DomTree dom_tree = graph.build_dominator_tree();
+    DomTree postdom_tree = graph.build_postdominator_tree();
+
+    std::filesystem::path snapshot_path = DUMP_DIR / "graph.snap";
+    graph.save_snapshot(snapshot_path);
+
+    MappedFile snapshot(snapshot_path);
+    ASSERT_TRUE(DAGraph::is_snapshot(snapshot));
+
+    DAGraph loaded = DAGraph::from_snapshot(snapshot, false);
+
+    ASSERT_EQ(loaded.node_count(), graph.node_count());
+    for (NodeId node = 0; node < graph.node_count(); node++)
+        EXPECT_EQ(loaded.get_node_index(node), graph.get_node_index(node));
+
+    EXPECT_EQ(loaded.topological_order(), graph.topological_order());
+    EXPECT_TRUE(loaded.topological_sort_check());
+    EXPECT_TRUE(loaded.build_dominator_tree() == dom_tree);
+    EXPECT_TRUE(loaded.build_postdominator_tree() == postdom_tree);
+}
+
+TEST(ExamplesTest, TruncatedSnapshot) {
+    std::stringstream file = read_from_file("example.txt");
+    DAGraph graph(file, {}, false);
+
+    std::filesystem::path snapshot_path = DUMP_DIR / "graph.snap";
+    graph.save_snapshot(snapshot_path);
+    std::filesystem::resize_file(snapshot_path, std::filesystem::file_size(snapshot_path) - 1);
+
+    MappedFile snapshot(snapshot_path);
+    EXPECT_THROW({
+        DAGraph::from_snapshot(snapshot, false);
+    }, DAGraph::creation_error);
+}
+
+TEST(ExamplesTest, CorruptedSnapshot) {
+    std::stringstream file = read_from_file("example_dominators.txt");
+    DAGraph graph(file, {}, false);
+    graph.build_postdominator_tree();
+
+    std::filesystem::path snapshot_path = DUMP_DIR / "graph.snap";
+    graph.save_snapshot(snapshot_path);
+
+    // Postdominator idoms are followed only by the offset of the empty condensed section
+    const size_t idom_offset = std::filesystem::file_size(snapshot_path) - sizeof(size_t) -
+                               graph.node_count() * sizeof(NodeId);
+
+    // Node 2 becomes its own idom, the tree gets a loop
+    std::fstream snapshot_file(snapshot_path, std::ios::binary | std::ios::in | std::ios::out);
+    const NodeId looped = 2;
+    snapshot_file.seekp(static_cast<std::streamoff>(idom_offset + looped * sizeof(NodeId)));
+    snapshot_file.write(reinterpret_cast<const char*>(&looped), sizeof(looped));
+    snapshot_file.close();
+
+    MappedFile snapshot(snapshot_path);
+    try {
+        DAGraph::from_snapshot(snapshot, false);
+        FAIL() << "Corruption is not detected";
+    } catch (const DAGraph::creation_error& e) {
+        EXPECT_STREQ(e.what(), "snapshot contains corrupted dominator tree");
+    }
+}
+
+TEST(ExamplesTest, TopologicalOrderViolation) {
+    std::stringstream file = read_from_file("example.txt");
+    DAGraph graph(file, {}, false);
+
+    for (size_t thread_count: {1, 2, 8}) {
+        std::optional<Adjacency::Edge> violation = graph.find_topological_order_violation(thread_count);
+
+        ASSERT_TRUE(violation.has_value());
+        EXPECT_EQ(graph.get_node_index(violation->first),  3);
+        EXPECT_EQ(graph.get_node_index(violation->second), 2);
+    }
+
+    graph.topological_sort();
+
+    EXPECT_FALSE(graph.find_topological_order_violation().has_value());
+    EXPECT_FALSE(graph.find_topological_order_violation(8).has_value());
+}
+
+TEST(ExamplesTest, DotDump) {
+    DAGraph graph("3 5 7\n5 7\n", {}, false);
+    graph.dump(DUMP_DIR / "input");
+
+    std::string dot = read_from_file(DUMP_DIR / "input.dot").str();
+
+    EXPECT_TRUE(dot.starts_with("digraph List{\n"));
+    EXPECT_TRUE(dot.ends_with("\n}\n"));
+
+    EXPECT_NE(dot.find("\nnode_0 [label=\"Start\"]\n"), std::string::npos);
+    EXPECT_NE(dot.find(std::format("\nnode_{} [label=\"End\"]\n", DumpableNode::END)), std::string::npos);
+    EXPECT_NE(dot.find("\nnode_5 [label=\"Node5\"]\n"), std::string::npos);
+    EXPECT_NE(dot.find("node_3->node_5[color=white]\n"), std::string::npos);
+    EXPECT_NE(dot.find("node_5->node_7[color=white]\n"), std::string::npos);
+
+    // Repeated dumps write the same text
+    graph.dump(DUMP_DIR / "again");
+    EXPECT_EQ(read_from_file(DUMP_DIR / "again.dot").str(), dot);
+}
+
+TEST(ExamplesTest, SizeAwareDumps) {
+    DAGraph graph("1 2\n2 3\n3 4 5\n4 6\n5 6\n6 7\n7 8\n", {}, false);
+
+    auto contains = [](const std::string& dot, const std::string& text) {
+        return dot.find(text) != std::string::npos;
+    };
+
+    NodeId node_4 = graph.find_node(4);
+    ASSERT_NE(node_4, INVALID_NODE);
+    EXPECT_EQ(graph.find_node(42), INVALID_NODE);
+
+    graph.dump_neighborhood(DUMP_DIR / "neighborhood", std::span(&node_4, 1), 1);
+    std::string dot = read_from_file(DUMP_DIR / "neighborhood.dot").str();
+
+    EXPECT_TRUE(contains(dot, "\nnode_4 [label=\"Node4\"]\n"));
+    EXPECT_TRUE(contains(dot, "\nnode_3 [label=\"Node3\", style=\"filled,dashed\"]\n"));
+    EXPECT_TRUE(contains(dot, "node_3->node_4[color=white]\n"));
+    EXPECT_TRUE(contains(dot, "node_4->node_6[color=white]\n"));
+    EXPECT_FALSE(contains(dot, "node_5"));
+    EXPECT_FALSE(contains(dot, "node_2"));
+
+    graph.dump_collapsed(DUMP_DIR / "collapsed");
+    dot = read_from_file(DUMP_DIR / "collapsed.dot").str();
+
+    EXPECT_TRUE(contains(dot, "\nnode_1 [label=\"Node1 .. Node3\\n3 nodes\""));
+    EXPECT_TRUE(contains(dot, "\nnode_6 [label=\"Node6 .. Node8\\n3 nodes\""));
+    EXPECT_TRUE(contains(dot, "node_1->node_5[color=white]\n"));
+    EXPECT_TRUE(contains(dot, std::format("node_6->node_{}[color=white]\n", DumpableNode::END)));
+    EXPECT_FALSE(contains(dot, "node_2"));
+    EXPECT_FALSE(contains(dot, "node_7"));
+
+    DomTree dom_tree = graph.build_dominator_tree();
+    dom_tree.dump_subtree(DUMP_DIR / "dom_subtree", 3, 1);
+    dot = read_from_file(DUMP_DIR / "dom_subtree.dot").str();
+
+    EXPECT_TRUE(contains(dot, "\nnode_5 [label=\"Node5\"]\n"));
+    EXPECT_TRUE(contains(dot, "\nnode_6 [label=\"Node6\", style=\"filled,dashed\"]\n"));
+    EXPECT_TRUE(contains(dot, "node_3->node_6[color=white]\n"));
+    EXPECT_FALSE(contains(dot, "node_7"));
+    EXPECT_FALSE(contains(dot, "node_1"));
+}
+
+TEST(ExamplesTest, BackgroundImageRendering) {
+    ImageRenderer renderer(2);
+
+    std::stringstream file = read_from_file("example_dominators.txt");
+    DAGraph graph(file);
+
+    graph.dump(DUMP_DIR / "input", &renderer);
+    graph.build_dominator_tree().dump(DUMP_DIR / "dom_tree", &renderer);
+    graph.build_postdominator_tree().dump(DUMP_DIR / "postdom_tree", &renderer);
+
+    renderer.wait();
+
+    EXPECT_TRUE(std::filesystem::exists(DUMP_DIR / "dom_tree.dot"));
+}
+
+TEST(ExamplesTest, PhaseStats) {
+    if (!STATS_ENABLED)
+        GTEST_SKIP() << "built without GRAPHS_ENABLE_STATS";
+
+    reset_stats();
+
+    std::stringstream file = read_from_file("example_dominators.txt");
+    DAGraph graph(file, {}, false);
+    graph.build_dominator_tree();
+
+    graph.build_dominator_tree(DAGraph::DomAlgorithm::DOMINATOR_SETS);
+    graph.build_postdominator_tree(DAGraph::DomAlgorithm::DOMINATOR_SETS);
+
+    // The cached Kahn order is only renumbered
+    graph.topological_sort();
+    graph.topological_sort();
+
+    std::map<std::string, PhaseStats> stats = collected_stats();
+
+    ASSERT_TRUE(stats.contains("parse"));
+    EXPECT_EQ(stats["parse"].calls, 1);
+    EXPECT_GT(stats["build"].allocations, 0);
+    EXPECT_EQ(stats["dom_tree_build"].calls, 1);
+
+    // Semi-NCA visits successors in DFS and predecessors of every reachable node
+    EXPECT_EQ(stats["immediate_dominators"].nodes_visited, graph.node_count());
+    EXPECT_EQ(stats["immediate_dominators"].edges_visited, 2 * graph.successors().edge_count());
+
+    EXPECT_EQ(stats["dom_tree_insertion"].calls, 1);
+    EXPECT_EQ(stats["postdom_tree_insertion"].calls, 1);
+    EXPECT_EQ(stats["dom_tree_insertion"].nodes_visited, graph.node_count());
+
+    EXPECT_EQ(stats["topological_levels"].calls, 1);
+    EXPECT_EQ(stats["topological_levels"].edges_visited, graph.successors().edge_count());
+    EXPECT_FALSE(stats.contains("topological_sort_dfs"));
+}
+
 TEST(ExamplesTest, ExampleLoop) {
     EXPECT_THROW({
         std::stringstream file = read_from_file("example_loop.txt");
@@ -120,6 +415,123 @@ TEST(ExamplesTest, ExampleSelfLoop) {
     }, DAGraph::loops_detected);
 }
 
+TEST(ExamplesTest, LoopReport) {
+    try {
+        DAGraph graph("1 2\n2 3 5\n3 1\n4 4 5\n5 6\n", {}, false);
+        FAIL() << "Loops are not detected";
+    } catch (const DAGraph::loops_detected& e) {
+        EXPECT_STREQ(e.what(), "2");
+        EXPECT_EQ(e.cycles, (std::vector<std::vector<NodeIdx>>{{1, 2, 3}, {4}}));
+    }
+
+    // Component {1, 2, 3} is reported with its shortest cycle through 1
+    try {
+        DAGraph graph("1 3 2\n2 1\n3 1\n", {}, false);
+        FAIL() << "Loops are not detected";
+    } catch (const DAGraph::loops_detected& e) {
+        EXPECT_EQ(e.cycles, (std::vector<std::vector<NodeIdx>>{{1, 3}}));
+    }
+}
+
+TEST(ExamplesTest, LoopCondensation) {
+    std::stringstream file = read_from_file("example_loop.txt");
+    DAGraph graph(file.view(), {}, false, 1, DAGraph::LoopPolicy::CONDENSE);
+
+    ASSERT_EQ(graph.node_count(), 4);
+
+    NodeId loop = graph.find_node(3);
+    ASSERT_NE(loop, INVALID_NODE);
+
+    std::vector<NodeIdx> loop_indexes(graph.condensed_indexes(loop).begin(),
+                                      graph.condensed_indexes(loop).end());
+    EXPECT_EQ(loop_indexes, (std::vector<NodeIdx>{3, 5, 7, 9}));
+    EXPECT_TRUE(graph.condensed_indexes(graph.find_node(2)).empty());
+
+    std::map<NodeIdx, NodeIdx> expected_idoms = {
+        {3, DumpableNode::START}, {2, 3}, {DumpableNode::END, 2},
+    };
+    EXPECT_EQ(graph.build_dominator_tree().immediate_dominators(), expected_idoms);
+
+    // Loop without entry and exit gets connected to Start and End
+    DAGraph closed_loop("1 2\n2 1\n3\n", {}, false, 1, DAGraph::LoopPolicy::CONDENSE);
+
+    EXPECT_EQ(closed_loop.node_count(), 4);
+    EXPECT_TRUE(closed_loop.build_postdominator_tree().postdominates(DumpableNode::END, 1));
+
+    std::filesystem::path snapshot_path = DUMP_DIR / "condensed.snap";
+    graph.save_snapshot(snapshot_path);
+
+    MappedFile snapshot(snapshot_path);
+    DAGraph loaded = DAGraph::from_snapshot(snapshot, false);
+
+    NodeId loaded_loop = loaded.find_node(3);
+    ASSERT_NE(loaded_loop, INVALID_NODE);
+    EXPECT_TRUE(std::ranges::equal(loaded.condensed_indexes(loaded_loop), loop_indexes));
+    EXPECT_TRUE(loaded.condensed_indexes(loaded.find_node(2)).empty());
+}
+
+TEST(ExamplesTest, ExampleDominatorsSemiNCA) {
+    std::stringstream file = read_from_file("example_dominators.txt");
+    DAGraph graph(file);
+
+    std::map<NodeIdx, NodeIdx> expected_idoms = {
+        {100, DumpableNode::START},
+        {1, 100}, {2, 100}, {3, 100}, {4, 100}, {5, 2}, {6, 3}, {7, 3}, {8, 100},
+        {9, 3}, {10, 7}, {11, 100}, {12, 4}, {DumpableNode::END, 11},
+    };
+
+    EXPECT_EQ(graph.build_dominator_tree().immediate_dominators(), expected_idoms);
+}
+
+TEST(ExamplesTest, ExamplePostdominatorsSemiNCA) {
+    std::stringstream file = read_from_file("example_dominators.txt");
+    DAGraph graph(file);
+
+    std::map<NodeIdx, NodeIdx> expected_idoms = {
+        {DumpableNode::START, 100},
+        {100, 11}, {1, 4}, {2, 8}, {3, 9}, {4, 12}, {5, 8}, {6, 9}, {7, 9},
+        {8, 11}, {9, 11}, {10, 9}, {11, DumpableNode::END}, {12, 8},
+    };
+
+    DomTree postdom_tree = graph.build_postdominator_tree();
+    EXPECT_EQ(postdom_tree.immediate_dominators(), expected_idoms);
+
+    EXPECT_TRUE(postdom_tree.postdominates(9, 7));
+    EXPECT_TRUE(postdom_tree.postdominates(DumpableNode::END, DumpableNode::START));
+    EXPECT_FALSE(postdom_tree.postdominates(4, 2));
+    EXPECT_EQ(postdom_tree.nearest_common_dominator(5, 12), 8);
+}
+
+TEST(ExamplesTest, EdgeEdits) {
+    std::stringstream file = read_from_file("example.txt");
+    DAGraph graph(file, {}, false);
+
+    graph.topological_sort();
+
+    // Every Start and End edit is rejected, so is removal of a missing edge
+    EXPECT_THROW(graph.add_edge(DAGraph::START_ID, 2), DAGraph::edit_error);
+    EXPECT_THROW(graph.remove_edge(2, DAGraph::END_ID), DAGraph::edit_error);
+    EXPECT_THROW(graph.add_edge(2, static_cast<NodeId>(graph.node_count())), DAGraph::edit_error);
+    EXPECT_THROW(graph.add_edge(2, 2), DAGraph::loops_detected);
+
+    NodeId source = graph.topological_order()[1];
+    NodeId last   = graph.topological_order()[graph.node_count() - 2];
+
+    EXPECT_THROW(graph.remove_edge(last, source), DAGraph::edit_error);
+    EXPECT_THROW(graph.add_edge(last, source), DAGraph::loops_detected);
+
+    const ImmediateDominators& doms = graph.immediate_dominators();
+
+    graph.add_edge(source, last);
+    EXPECT_TRUE(graph.topological_order().empty());
+    EXPECT_EQ(doms.idom, compute_immediate_dominators(graph.successors(), graph.predecessors(),
+                                                      DAGraph::START_ID).idom);
+
+    graph.remove_edge(source, last);
+    graph.topological_sort();
+    EXPECT_TRUE(graph.topological_sort_check());
+}
+
 TEST(ExamplesTest, ExampleDominators) {
     EXPECT_NO_THROW({
         std::stringstream file = read_from_file("example.txt");
@@ -132,6 +544,317 @@ TEST(ExamplesTest, ExampleDominators) {
     });
 }
 
+TEST(LargeGraphTest, LongChain) {
+    constexpr size_t CHAIN_LENGTH = 300000;
+
+    std::stringstream input;
+    for (size_t i = 1; i < CHAIN_LENGTH; i++)
+        input << i << " " << i + 1 << '\n';
+
+    DAGraph graph(input, DUMP_DIR / "input", false);
+
+    graph.topological_sort();
+    EXPECT_EQ(graph.topological_sort_check(), true);
+
+    DomTree dom_tree = graph.build_dominator_tree();
+    dom_tree.dump(DUMP_DIR / "dom_tree");
+
+    DomTree postdom_tree = graph.build_postdominator_tree();
+    postdom_tree.dump(DUMP_DIR / "postdom_tree");
+
+    EXPECT_EQ(dom_tree.immediate_dominators().size(), CHAIN_LENGTH + 1);
+    EXPECT_EQ(postdom_tree.immediate_dominators().size(), CHAIN_LENGTH + 1);
+
+    EXPECT_TRUE(dom_tree.strictly_dominates(1, CHAIN_LENGTH));
+    EXPECT_EQ(postdom_tree.nearest_common_dominator(1, CHAIN_LENGTH / 2), CHAIN_LENGTH / 2);
+
+    EXPECT_GT(peak_rss_bytes(), CHAIN_LENGTH * sizeof(NodeId));
+}
+
+TEST(LargeGraphTest, WideLevels) {
+    constexpr size_t LAYER_WIDTH = 10000;
+    constexpr size_t LAYER_COUNT = 4;
+
+    std::mt19937 random_generator;
+    std::stringstream input;
+
+    for (size_t layer = 0; layer + 1 < LAYER_COUNT; layer++) {
+        for (size_t i = 0; i < LAYER_WIDTH; i++) {
+            input << layer * LAYER_WIDTH + i + 1;
+
+            for (size_t child = 0; child < 3; child++)
+                input << " " << (layer + 1) * LAYER_WIDTH + random_generator() % LAYER_WIDTH + 1;
+
+            input << '\n';
+        }
+    }
+
+    DAGraph graph(input.view(), {}, false);
+    DAGraph parallel_graph(input.view(), {}, false);
+
+    const TopologicalLevels& levels = graph.topological_levels();
+    const TopologicalLevels& parallel_levels = parallel_graph.topological_levels(4);
+
+    EXPECT_EQ(levels.order, parallel_levels.order);
+    EXPECT_EQ(levels.level_offsets, parallel_levels.level_offsets);
+    EXPECT_EQ(levels.order.size(), graph.node_count());
+
+    std::vector<size_t> node_levels(graph.node_count());
+    for (size_t level = 0; level < levels.level_count(); level++) {
+        for (NodeId node: levels.level(level))
+            node_levels[node] = level;
+    }
+
+    for (NodeId node = 0; node < graph.node_count(); node++) {
+        for (NodeId child: graph.successors()[node])
+            EXPECT_LT(node_levels[node], node_levels[child]);
+    }
+}
+
+TEST(LargeGraphTest, DominatorBitsets) {
+    std::stringstream input = build_random_dag_description(600);
+    DAGraph graph(input, {}, false);
+
+    EXPECT_TRUE(graph.build_dominator_tree(DAGraph::DomAlgorithm::DOMINATOR_BITSETS) ==
+                graph.build_dominator_tree());
+    EXPECT_TRUE(graph.build_postdominator_tree(DAGraph::DomAlgorithm::DOMINATOR_BITSETS) ==
+                graph.build_postdominator_tree());
+}
+
+TEST(LargeGraphTest, GeneratedShapes) {
+    constexpr size_t NODE_COUNT = 200000;
+
+    for (GraphShape shape: {GraphShape::CHAIN, GraphShape::WIDE_FAN_OUT, GraphShape::DIAMOND_LADDER,
+                            GraphShape::RANDOM_SPARSE, GraphShape::CFG_LIKE}) {
+        GraphGenerator generator({.shape = shape, .node_count = NODE_COUNT, .shuffle_indexes = true});
+
+        std::stringstream text;
+        size_t edge_count = generator.write_text(text);
+
+        DAGraph graph(generator, false);
+        DAGraph parsed_graph(text, {}, false);
+
+        ASSERT_EQ(graph.node_count(), NODE_COUNT + 2) << graph_shape_name(shape);
+        ASSERT_EQ(parsed_graph.node_count(), graph.node_count());
+        EXPECT_GE(graph.successors().edge_count(), edge_count);
+
+        graph.topological_sort();
+        EXPECT_TRUE(graph.topological_sort_check());
+    }
+}
+
+TEST(LargeGraphTest, GeneratedLoops) {
+    for (GraphShape shape: {GraphShape::CHAIN, GraphShape::WIDE_FAN_OUT, GraphShape::DIAMOND_LADDER,
+                            GraphShape::RANDOM_SPARSE, GraphShape::CFG_LIKE}) {
+        GraphGenerator generator({.shape = shape, .node_count = 10000, .seed = 1, .loop_count = 3});
+
+        EXPECT_THROW(DAGraph(generator, false), DAGraph::loops_detected) << graph_shape_name(shape);
+
+        DAGraph graph(generator, false, DAGraph::LoopPolicy::CONDENSE);
+
+        StronglyConnectedComponents components = compute_strongly_connected_components(graph.successors());
+        EXPECT_TRUE(components.cyclic_components.empty());
+        EXPECT_EQ(components.count, graph.node_count());
+
+        graph.topological_sort();
+        EXPECT_TRUE(graph.topological_sort_check()) << graph_shape_name(shape);
+        EXPECT_EQ(graph.build_dominator_tree(), graph.build_dominator_tree(DAGraph::DomAlgorithm::DOMINATOR_BITSETS));
+    }
+}
+
+TEST(LargeGraphTest, ParallelDominatorLevels) {
+    for (GraphShape shape: {GraphShape::WIDE_FAN_OUT, GraphShape::DIAMOND_LADDER, GraphShape::RANDOM_SPARSE,
+                            GraphShape::CFG_LIKE}) {
+        GraphGenerator generator({.shape = shape, .node_count = 100000, .density = 3, .seed = 5});
+
+        const DAGraph graph(generator, false);
+        const DAGraph parallel_graph(generator, false);
+
+        DomTree dom_tree = parallel_graph.build_dominator_tree(DAGraph::DomAlgorithm::LEVELS, 4);
+        DomTree postdom_tree = parallel_graph.build_postdominator_tree(DAGraph::DomAlgorithm::LEVELS, 4);
+
+        EXPECT_EQ(parallel_graph.immediate_dominators().idom, graph.immediate_dominators().idom)
+            << graph_shape_name(shape);
+        EXPECT_EQ(parallel_graph.immediate_dominators().depth, graph.immediate_dominators().depth);
+        EXPECT_EQ(parallel_graph.immediate_postdominators().idom, graph.immediate_postdominators().idom)
+            << graph_shape_name(shape);
+
+        EXPECT_TRUE(dom_tree == graph.build_dominator_tree());
+        EXPECT_TRUE(postdom_tree == graph.build_postdominator_tree());
+    }
+}
+
+TEST(LevelThreadsTest, EveryThreadRunsEveryLevel) {
+    constexpr size_t THREAD_COUNT = 4;
+    constexpr size_t LEVEL_COUNT  = 100;
+
+    std::vector<size_t> runs(THREAD_COUNT, 0);
+    {
+        LevelThreads threads(THREAD_COUNT);
+        ASSERT_EQ(threads.thread_count(), THREAD_COUNT);
+
+        for (size_t level = 0; level < LEVEL_COUNT; level++) {
+            threads.run([&](size_t thread) { runs[thread]++; });
+
+            // Results of a level are visible once run() returns
+            for (size_t thread = 0; thread < THREAD_COUNT; thread++)
+                ASSERT_EQ(runs[thread], level + 1);
+        }
+    }
+
+    EXPECT_EQ(runs, std::vector<size_t>(THREAD_COUNT, LEVEL_COUNT));
+}
+
+TEST(LargeGraphTest, DeepDominatorLevels) {
+    const DAGraph graph(build_chain_with_sink_description(200000), {}, false);
+    const TopologicalLevels& levels = graph.topological_levels();
+
+    size_t nca_steps = 0;
+    ImmediateDominators doms = compute_immediate_dominators_by_levels(
+        graph.predecessors(), levels, DAGraph::START_ID, false, 4, &nca_steps);
+    ImmediateDominators postdoms = compute_immediate_dominators_by_levels(
+        graph.successors(), levels, DAGraph::END_ID, true, 4, &nca_steps);
+
+    // Climbing idom chains one step at a time would take up to the chain length per predecessor
+    const size_t max_steps_per_edge = MAX_NCA_STEPS_PER_LOG_DEPTH * std::bit_width(graph.node_count());
+    EXPECT_LE(nca_steps, 2 * graph.successors().edge_count() * max_steps_per_edge);
+
+    EXPECT_EQ(doms.idom, graph.immediate_dominators().idom);
+    EXPECT_EQ(doms.depth, graph.immediate_dominators().depth);
+    EXPECT_EQ(postdoms.idom, graph.immediate_postdominators().idom);
+}
+
+TEST(LargeGraphTest, DeepIncrementalDominators) {
+    constexpr size_t CHAIN_LENGTH = 100000;
+
+    DAGraph graph(build_chain_with_sink_description(CHAIN_LENGTH), {}, false);
+    graph.immediate_dominators();
+    graph.immediate_postdominators();
+
+    const NodeId sink   = graph.find_node(CHAIN_LENGTH + 1);
+    const NodeId middle = graph.find_node(CHAIN_LENGTH / 2);
+    const NodeId top    = graph.find_node(2);
+
+    // Few affected nodes whose predecessors span the whole chain, then an edit affecting half of it
+    graph.remove_edge(middle, sink);
+    graph.add_edge(middle, sink);
+    graph.add_edge(top, middle);
+
+    EXPECT_EQ(graph.immediate_dominators().idom,
+              compute_immediate_dominators(graph.successors(), graph.predecessors(), DAGraph::START_ID).idom);
+    EXPECT_EQ(graph.immediate_postdominators().idom,
+              compute_immediate_dominators(graph.predecessors(), graph.successors(), DAGraph::END_ID).idom);
+
+    // The sink merges idoms of predecessors from every depth of the chain
+    ImmediateDominators doms = graph.immediate_dominators();
+    size_t nca_steps = 0;
+    update_immediate_dominators(graph.predecessors(), std::span(&sink, 1), &doms, &nca_steps);
+
+    EXPECT_EQ(doms.idom, graph.immediate_dominators().idom);
+    EXPECT_LE(nca_steps, graph.predecessors()[sink].size() * MAX_NCA_STEPS_PER_LOG_DEPTH *
+                         std::bit_width(graph.node_count()));
+}
+
+TEST(LargeGraphTest, RelabelNodes) {
+    for (GraphShape shape: {GraphShape::WIDE_FAN_OUT, GraphShape::DIAMOND_LADDER, GraphShape::RANDOM_SPARSE,
+                            GraphShape::CFG_LIKE}) {
+        GraphGenerator generator({.shape = shape, .node_count = 20000, .seed = 3, .shuffle_indexes = true});
+
+        const DAGraph graph(generator, false);
+        DomTree dom_tree     = graph.build_dominator_tree();
+        DomTree postdom_tree = graph.build_postdominator_tree();
+
+        for (DAGraph::NodeOrder order: {DAGraph::NodeOrder::REVERSE_POSTORDER, DAGraph::NodeOrder::BREADTH_FIRST}) {
+            DAGraph relabeled(generator, false);
+            relabeled.build_dominator_tree();
+
+            std::vector<NodeId> new_ids = relabeled.relabel_nodes(order);
+
+            ASSERT_EQ(new_ids.size(), graph.node_count()) << graph_shape_name(shape);
+            EXPECT_EQ(new_ids[DAGraph::START_ID], DAGraph::START_ID);
+            EXPECT_EQ(new_ids[DAGraph::END_ID], DAGraph::END_ID);
+            EXPECT_EQ(relabeled.successors().edge_count(), graph.successors().edge_count());
+
+            for (NodeId node = 0; node < graph.node_count(); node++) {
+                EXPECT_EQ(relabeled.get_node_index(new_ids[node]), graph.get_node_index(node));
+                EXPECT_EQ(relabeled.find_node(graph.get_node_index(node)), new_ids[node]);
+                EXPECT_EQ(relabeled.successors()[new_ids[node]].size(), graph.successors()[node].size());
+            }
+
+            // Cached idoms of the old numbering are dropped
+            EXPECT_TRUE(relabeled.build_dominator_tree() == dom_tree) << graph_shape_name(shape);
+            EXPECT_TRUE(relabeled.build_postdominator_tree() == postdom_tree);
+
+            relabeled.topological_sort();
+            EXPECT_TRUE(relabeled.topological_sort_check());
+
+            // Sorting renumbers indexes
+            for (NodeId node = 0; node < relabeled.node_count(); node++)
+                EXPECT_EQ(relabeled.find_node(relabeled.get_node_index(node)), node);
+        }
+
+        // Reverse postorder ids grow along every edge except edges to End
+        DAGraph relabeled(generator, false);
+        relabeled.relabel_nodes();
+
+        for (NodeId node = 0; node < relabeled.node_count(); node++) {
+            for (NodeId child: relabeled.successors()[node])
+                EXPECT_TRUE(child == DAGraph::END_ID || child > node);
+        }
+    }
+}
+
+TEST(LargeGraphTest, ConcurrentQueries) {
+    constexpr size_t THREAD_COUNT = 8;
+
+    GraphGenerator generator({.shape = GraphShape::CFG_LIKE, .node_count = 20000, .seed = 3});
+    const DAGraph graph(generator, false);
+
+    const DAGraph reference_graph(generator, false);
+    const DomTree reference_tree = reference_graph.build_dominator_tree();
+    const std::vector<NodeId> reference_idoms = reference_graph.immediate_dominators().idom;
+
+    const DomTree dom_tree = graph.build_dominator_tree();
+    const std::filesystem::path dump_dir = DUMP_DIR;
+
+    std::vector<char> matches(THREAD_COUNT, false);
+    {
+        std::vector<std::jthread> workers;
+
+        for (size_t thread = 0; thread < THREAD_COUNT; thread++) {
+            workers.emplace_back([&, thread]() {
+                TraversalState state;
+                bool match = graph.immediate_dominators().idom == reference_idoms;
+
+                // Lazily built analyses and tree query numbering are shared by all threads
+                graph.dominance_frontiers();
+                graph.dominator_sets();
+
+                for (NodeId node = static_cast<NodeId>(thread); node < graph.node_count(); node += 97) {
+                    NodeIdx index = graph.get_node_index(node);
+                    NodeIdx idom  = graph.get_node_index(reference_idoms[node]);
+
+                    match &= dom_tree.dominates(idom, index);
+                    match &= dom_tree.nearest_common_dominator(index, idom) == idom;
+                    match &= reference_tree.nearest_common_dominator(index, idom) == idom;
+
+                    std::vector<NodeId> reachable = graph.reachable_from(std::span(&node, 1), state);
+                    match &= !reachable.empty() && reachable.front() == node;
+                }
+
+                graph.dump(dump_dir / std::format("graph_{}", thread));
+                dom_tree.dump(dump_dir / std::format("dom_tree_{}", thread));
+
+                matches[thread] = match;
+            });
+        }
+    }
+
+    EXPECT_EQ(matches, std::vector<char>(THREAD_COUNT, true));
+    EXPECT_EQ(read_from_file(dump_dir / "graph_0.dot").str(),
+              read_from_file(dump_dir / std::format("graph_{}.dot", THREAD_COUNT - 1)).str());
+}
+
 class GraphGenTest: public testing::Test {
 public:
     explicit GraphGenTest(size_t size) : size_(size) {}
@@ -195,6 +918,147 @@ private:
         graph.dump(DUMP_DIR / "topo_sort");
 
         EXPECT_EQ(graph.topological_sort_check(), true);
+        EXPECT_EQ(graph.topological_sort_check(3), true);
+
+        DAGraph dfs_graph(input, DUMP_DIR / "input", false);
+
+        dfs_graph.topological_sort(DAGraph::TopoSortAlgorithm::DFS);
+
+        dfs_graph.dump(DUMP_DIR / "dfs_topo_sort");
+
+        EXPECT_EQ(dfs_graph.topological_sort_check(), true);
+    }
+};
+
+class DominatorTreeTest: public GraphGenTest {
+public:
+    explicit DominatorTreeTest(size_t size) : GraphGenTest(size) {}
+
+private:
+    void TestBody() override {
+        std::stringstream input = build_random_dag_description(size_);
+
+        DAGraph graph(input, DUMP_DIR / "input", false);
+
+        DomTree dom_tree = graph.build_dominator_tree();
+        dom_tree.dump(DUMP_DIR / "dom_tree");
+
+        DomTree reference_tree = graph.build_dominator_tree(DAGraph::DomAlgorithm::DOMINATOR_SETS);
+        reference_tree.dump(DUMP_DIR / "reference_dom_tree");
+
+        EXPECT_TRUE(dom_tree == reference_tree);
+
+        check_dominance_queries(&dom_tree, DumpableNode::START);
+        check_dominance_frontiers(&graph, &dom_tree);
+
+        EXPECT_TRUE(graph.build_dominator_tree(DAGraph::DomAlgorithm::DOMINATOR_BITSETS) == dom_tree);
+
+        ImmediateDominators by_levels = compute_immediate_dominators_by_levels(
+            graph.predecessors(), graph.topological_levels(), DAGraph::START_ID, false);
+        EXPECT_EQ(by_levels.idom, graph.immediate_dominators().idom);
+        EXPECT_EQ(by_levels.depth, graph.immediate_dominators().depth);
+
+        const DominatorSets& sets = graph.dominator_sets();
+        for (NodeId dominator = 0; dominator < graph.node_count(); dominator++) {
+            for (NodeId node = 0; node < graph.node_count(); node++) {
+                EXPECT_EQ(sets.dominates(dominator, node),
+                          dom_tree.dominates(graph.get_node_index(dominator), graph.get_node_index(node)));
+            }
+        }
+    }
+};
+
+class PostdominatorTreeTest: public GraphGenTest {
+public:
+    explicit PostdominatorTreeTest(size_t size) : GraphGenTest(size) {}
+
+private:
+    void TestBody() override {
+        std::stringstream input = build_random_dag_description(size_);
+
+        DAGraph graph(input, DUMP_DIR / "input", false);
+
+        DomTree postdom_tree = graph.build_postdominator_tree();
+        postdom_tree.dump(DUMP_DIR / "postdom_tree");
+
+        DomTree reference_tree = graph.build_postdominator_tree(DAGraph::DomAlgorithm::DOMINATOR_SETS);
+        reference_tree.dump(DUMP_DIR / "reference_postdom_tree");
+
+        EXPECT_TRUE(postdom_tree == reference_tree);
+
+        check_dominance_queries(&postdom_tree, DumpableNode::END);
+
+        EXPECT_TRUE(graph.build_postdominator_tree(DAGraph::DomAlgorithm::DOMINATOR_BITSETS) == postdom_tree);
+
+        ImmediateDominators by_levels = compute_immediate_dominators_by_levels(
+            graph.successors(), graph.topological_levels(), DAGraph::END_ID, true);
+        EXPECT_EQ(by_levels.idom, graph.immediate_postdominators().idom);
+        EXPECT_EQ(by_levels.depth, graph.immediate_postdominators().depth);
+    }
+};
+
+class IncrementalDominatorsTest: public GraphGenTest {
+public:
+    explicit IncrementalDominatorsTest(size_t size) : GraphGenTest(size) {}
+
+private:
+    void TestBody() override {
+        std::stringstream input = build_random_dag_description(size_);
+
+        DAGraph graph(input, DUMP_DIR / "input", false);
+        graph.immediate_dominators();
+        graph.immediate_postdominators();
+
+        std::mt19937 random_generator(static_cast<unsigned>(size_));
+
+        for (size_t edit = 0; edit < 4 * size_; edit++) {
+            NodeId parent = static_cast<NodeId>(2 + random_generator() % size_);
+            NodeId child  = static_cast<NodeId>(2 + random_generator() % size_);
+
+            if (graph.successors().contains_edge(parent, child)) {
+                graph.remove_edge(parent, child);
+            } else {
+                try {
+                    graph.add_edge(parent, child);
+                } catch (const DAGraph::loops_detected&) {
+                    continue;
+                }
+            }
+
+            ASSERT_EQ(graph.immediate_dominators().idom,
+                      compute_immediate_dominators(graph.successors(), graph.predecessors(),
+                                                   DAGraph::START_ID).idom);
+            ASSERT_EQ(graph.immediate_postdominators().idom,
+                      compute_immediate_dominators(graph.predecessors(), graph.successors(),
+                                                   DAGraph::END_ID).idom);
+        }
+
+        graph.build_dominator_tree().dump(DUMP_DIR / "dom_tree");
+
+        graph.topological_sort();
+        EXPECT_TRUE(graph.topological_sort_check(3));
+        EXPECT_TRUE(graph.build_dominator_tree() ==
+                    graph.build_dominator_tree(DAGraph::DomAlgorithm::DOMINATOR_SETS));
+    }
+};
+
+class ParallelParsingTest: public GraphGenTest {
+public:
+    explicit ParallelParsingTest(size_t size) : GraphGenTest(size) {}
+
+private:
+    void TestBody() override {
+        std::string input = build_random_dag_description(size_).str();
+
+        DAGraph graph(input, {}, false);
+        DAGraph parallel_graph(input, {}, false, 3);
+
+        ASSERT_EQ(graph.node_count(), parallel_graph.node_count());
+
+        for (NodeId node = 0; node < graph.node_count(); node++) {
+            EXPECT_EQ(graph.get_node_index(node), parallel_graph.get_node_index(node));
+            EXPECT_TRUE(std::ranges::equal(graph.successors()[node], parallel_graph.successors()[node]));
+        }
     }
 };
 
@@ -210,6 +1074,94 @@ void define_range_test(const char* name, size_t min_size, size_t max_size) {
     }
 }
 
+// Compares queries with walks up the immediate dominators
+void check_dominance_queries(DomTree* dom_tree, NodeIdx root) {
+    std::map<NodeIdx, NodeIdx> idoms = dom_tree->immediate_dominators();
+    idoms.emplace(root, root);
+
+    auto ancestors = [&idoms](NodeIdx node) {
+        std::vector<NodeIdx> path = {node};
+        while (path.back() != idoms.at(path.back()))
+            path.push_back(idoms.at(path.back()));
+
+        return path;
+    };
+
+    for (auto [first, first_idom]: idoms) {
+        std::vector<NodeIdx> first_path = ancestors(first);
+
+        for (auto [second, second_idom]: idoms) {
+            std::vector<NodeIdx> second_path = ancestors(second);
+
+            bool dominates = std::ranges::find(second_path, first) != second_path.end();
+            EXPECT_EQ(dom_tree->dominates(first, second), dominates);
+            EXPECT_EQ(dom_tree->strictly_dominates(first, second), dominates && first != second);
+
+            NodeIdx common = *std::ranges::find_if(first_path, [&second_path](NodeIdx node) {
+                return std::ranges::find(second_path, node) != second_path.end();
+            });
+            EXPECT_EQ(dom_tree->nearest_common_dominator(first, second), common);
+        }
+    }
+}
+
+// Compares frontiers with the definition: y is in DF(x) if x dominates a predecessor of y
+// but doesn't strictly dominate y
+void check_dominance_frontiers(DAGraph* graph, DomTree* dom_tree) {
+    const Adjacency& frontiers = graph->dominance_frontiers();
+
+    for (NodeId node = 0; node < graph->node_count(); node++) {
+        NodeIdx index = graph->get_node_index(node);
+
+        std::vector<NodeId> expected;
+        for (NodeId join = 0; join < graph->node_count() && dom_tree->contains(index); join++) {
+            NodeIdx join_index = graph->get_node_index(join);
+            if (dom_tree->strictly_dominates(index, join_index))
+                continue;
+
+            for (NodeId pred: graph->predecessors()[join]) {
+                if (dom_tree->contains(graph->get_node_index(pred)) &&
+                    dom_tree->dominates(index, graph->get_node_index(pred))) {
+                    expected.push_back(join);
+                    break;
+                }
+            }
+        }
+
+        std::vector<NodeId> frontier(frontiers[node].begin(), frontiers[node].end());
+        std::ranges::sort(frontier);
+        EXPECT_EQ(frontier, expected);
+    }
+
+    // DF+ is the fixed point of DF over the nodes and their frontiers
+    std::vector<NodeId> nodes;
+    for (NodeId node = 2; node < graph->node_count(); node += 3)
+        nodes.push_back(node);
+
+    std::vector<bool> expected_flags(graph->node_count(), false);
+    for (bool changed = true; changed;) {
+        changed = false;
+
+        for (NodeId node = 0; node < graph->node_count(); node++) {
+            if (!expected_flags[node] && std::ranges::find(nodes, node) == nodes.end())
+                continue;
+
+            for (NodeId frontier_node: frontiers[node]) {
+                changed |= !expected_flags[frontier_node];
+                expected_flags[frontier_node] = true;
+            }
+        }
+    }
+
+    std::vector<NodeId> expected;
+    for (NodeId node = 0; node < graph->node_count(); node++) {
+        if (expected_flags[node])
+            expected.push_back(node);
+    }
+
+    EXPECT_EQ(graph->iterated_dominance_frontier(nodes), expected);
+}
+
 } // namespace
 
 int main(int argc, char** argv) {
@@ -218,6 +1170,10 @@ int main(int argc, char** argv) {
     define_range_test<InputNoLoopTest>    ("InputNoLoopTest",     0, 100);
     define_range_test<InputLoopTest>      ("InputLoopTest",       1, 100);
     define_range_test<TopologicalSortTest>("TopologicalSortTest", 0, 100);
+    define_range_test<DominatorTreeTest>  ("DominatorTreeTest",   0, 30);
+    define_range_test<PostdominatorTreeTest>("PostdominatorTreeTest", 0, 30);
+    define_range_test<IncrementalDominatorsTest>("IncrementalDominatorsTest", 1, 30);
+    define_range_test<ParallelParsingTest>("ParallelParsingTest", 0, 100);
 
     return RUN_ALL_TESTS();
 }